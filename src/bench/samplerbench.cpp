@@ -0,0 +1,131 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Microbenchmark for RollingSampler: pushes with a min / max / mean query
+ * after each, as FlowControl and the profilers do, against the old
+ * vector-backed sampler that erased from the front and rescanned. Then
+ * pushes with a p95 query after each, as the adaptive jitter buffer does,
+ * exact against bucketed.
+ *
+ * usage: solemnsky_bench [pushes]
+ */
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "util/types.hpp"
+
+namespace {
+
+/**
+ * The sampler as it was: erase from the front, rescan on every query.
+ */
+template<typename Data>
+class NaiveSampler {
+ private:
+  std::vector<Data> data;
+  const unsigned int maxMemory;
+
+ public:
+  NaiveSampler(const unsigned int maxMemory) : maxMemory(maxMemory) { }
+
+  void push(const Data value) {
+    if (data.size() >= maxMemory) data.erase(data.begin());
+    data.push_back(value);
+  }
+
+  template<typename Result>
+  Result mean() const {
+    if (data.size() == 0) return 0;
+    return Result(std::accumulate(data.begin(), data.end(), Data(0)))
+        / Result(data.size());
+  }
+
+  Data max() const {
+    if (data.size() == 0) return 0;
+    return *std::max_element(data.begin(), data.end());
+  }
+
+  Data min() const {
+    if (data.size() == 0) return 0;
+    return *std::min_element(data.begin(), data.end());
+  }
+};
+
+template<typename Sampler>
+double benchmark(const std::vector<Time> &values, const unsigned int window) {
+  Sampler sampler(window);
+  Time sink = 0;
+  const auto begin = std::chrono::steady_clock::now();
+  for (const Time value : values) {
+    sampler.push(value);
+    sink += sampler.max() - sampler.min() + sampler.template mean<Time>();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  // Keep the compiler from optimizing the queries away.
+  if (sink == 42) std::cout << "";
+  return std::chrono::duration<double, std::nano>(end - begin).count()
+      / values.size();
+}
+
+template<typename Sampler>
+double benchmarkPercentile(const std::vector<Time> &values, Sampler sampler) {
+  Time sink = 0;
+  const auto begin = std::chrono::steady_clock::now();
+  for (const Time value : values) {
+    sampler.push(value);
+    sink += sampler.percentile(0.95);
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  if (sink == 42) std::cout << "";
+  return std::chrono::duration<double, std::nano>(end - begin).count()
+      / values.size();
+}
+
+}
+
+int main(int argc, char **argv) {
+  size_t pushes = 1000000;
+  if (argc > 1) pushes = std::stoul(argv[1]);
+
+  std::mt19937 generator(0);
+  std::normal_distribution<Time> offsets(0.1, 0.02);
+  std::vector<Time> values(pushes);
+  for (auto &value : values) value = offsets(generator);
+
+  std::cout << "window, naive ns/push, ring buffer ns/push" << std::endl;
+  for (const unsigned int window : {5u, 50u, 100u, 1000u}) {
+    std::cout << window << ", "
+              << benchmark<NaiveSampler<Time>>(values, window) << ", "
+              << benchmark<RollingSampler<Time>>(values, window)
+              << std::endl;
+  }
+
+  std::cout << "window, exact p95 ns/push, bucketed p95 ns/push" << std::endl;
+  for (const unsigned int window : {5u, 50u, 100u, 1000u}) {
+    std::cout << window << ", "
+              << benchmarkPercentile(values, RollingSampler<Time>(window))
+              << ", "
+              << benchmarkPercentile(values, RollingSampler<Time>(
+                  window, 0, 0.2, 100))
+              << std::endl;
+  }
+
+  return 0;
+}
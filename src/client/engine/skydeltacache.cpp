@@ -20,19 +20,87 @@
 namespace sky {
 
 SkyDeltaCache::SkyDeltaCache(Arena &arena, SkyHandle &skyHandle) :
-    Subsystem(arena), skyHandle(skyHandle) {}
+    Subsystem(arena), skyHandle(skyHandle), history(64) {}
 
-void SkyDeltaCache::receive(const Time timestamp, const SkyDelta &delta) {
-  deltaControl.registerMessage(arena.getUptime(), timestamp, delta);
+void SkyDeltaCache::recordStates(const Sky &sky,
+                                 const TimedMessage<SkyDelta> &delta) {
+  for (const auto &pair : delta.message.participations) {
+    // Our own plane is predicted, not interpolated.
+    if (role.client(pair.first)) continue;
+
+    // A new life doesn't interpolate from the last one.
+    const auto participation = sky.participations.find(pair.first);
+    const bool alive = participation != sky.participations.end()
+        and participation->second.plane;
+    if (!alive or pair.second.spawn) interpolation.forget(pair.first);
+    if (alive) {
+      interpolation.record(arena.getUptime(), delta.timestamp, pair.first,
+                           participation->second.plane->getState().physical);
+    }
+  }
+}
+
+void SkyDeltaCache::receive(const Time timestamp,
+                            const SkySequence sequence,
+                            const optional<SkySequence> &baseline,
+                            SkyDelta &&delta) {
+  if (baseline) {
+    const SkySnapshot *snapshot = history.find(baseline.get());
+    if (!snapshot or !SnapshotHistory::rebuild(delta, *snapshot)) {
+      appLog("Dropping sky delta with unknown baseline "
+                 + std::to_string(baseline.get()) + ".", LogOrigin::Client);
+      return;
+    }
+  }
+
+  history.record(sequence, delta);
+  if (!ack or sequence > ack.get()) {
+    ack = sequence;
+  } else {
+    // Reliable events overtaken by unreliable states, and maybe by newer
+    // reliable events.
+    std::set<PID> covered;
+    for (const auto &participation : delta.participations) {
+      const auto life = lives.find(participation.first);
+      if (life != lives.end() and life->second > sequence)
+        covered.insert(participation.first);
+    }
+    delta.dropState(covered);
+  }
+
+  for (const auto &participation : delta.participations) {
+    if (participation.second.spawn or participation.second.kill) {
+      auto &life = lives[participation.first];
+      life = std::max(life, sequence);
+    }
+  }
+  deltaControl.registerMessage(arena.getUptime(), timestamp, std::move(delta));
+}
+
+optional<SkySequence> SkyDeltaCache::getAck() const {
+  return ack;
+}
+
+const InterpolationBuffer &SkyDeltaCache::getInterpolation() const {
+  return interpolation;
+}
+
+void SkyDeltaCache::reset() {
+  deltaControl.reset();
+  history.clear();
+  ack.reset();
+  lives.clear();
+  interpolation.clear();
 }
 
 void SkyDeltaCache::onPoll() {
   if (auto sky = skyHandle.getSky()) {
-    while (const auto delta = deltaControl.pull(arena.getUptime())) {
-      sky->applyDelta(delta.get());
+    while (const auto delta = deltaControl.pullTimed(arena.getUptime())) {
+      sky->applyDelta(delta->message);
+      recordStates(*sky, delta.get());
     }
   } else {
-    deltaControl.reset();
+    reset();
   }
 }
 
@@ -41,6 +109,12 @@ void SkyDeltaCache::onDebugRefresh() {
   stats->averageWait = deltaControl.waitingTime.mean<Time>();
   stats->actualJitter =
     TimeDiff(deltaControl.offsets.max() - deltaControl.offsets.min());
+  const ClockSync &sync = deltaControl.getSync();
+  stats->estimatedJitter = sync.jitter();
+  stats->offsetError = sync.error();
+  stats->skew = sync.skew();
+  stats->delay = deltaControl.getDelay();
+  stats->flow = deltaControl.getStats();
 }
 
 void SkyDeltaCache::printDebug(Printer &p) {
@@ -48,6 +122,13 @@ void SkyDeltaCache::printDebug(Printer &p) {
   if (stats) {
     p.printLn("average time lost in cache: " + printTimeDiff(stats->averageWait));
     p.printLn("actual offset jitter" + printTimeDiff(stats->actualJitter));
+    p.printLn("estimated jitter: " + printTimeDiff(stats->estimatedJitter)
+                  + ", offset error: " + printTimeDiff(stats->offsetError));
+    p.printLn("clock skew: " + std::to_string(stats->skew));
+    p.printLn("buffer delay: " + printTimeDiff(stats->delay)
+                  + ", late: " + std::to_string(stats->flow.underruns)
+                  + ", held in time: " + std::to_string(stats->flow.avoided)
+                  + " of " + std::to_string(stats->flow.arrivals));
   } else {
     p.printLn("no stats collected yet...");
   }
@@ -21,6 +21,8 @@
 #pragma once
 #include "engine/arena.hpp"
 #include "engine/sky/skyhandle.hpp"
+#include "engine/sky/snapshothistory.hpp"
+#include "engine/sky/interpolation.hpp"
 #include "engine/flowcontrol.hpp"
 #include "util/printer.hpp"
 
@@ -31,8 +33,22 @@ class SkyDeltaCache: public Subsystem<Nothing> {
   SkyHandle &skyHandle;
   FlowControl<SkyDelta> deltaControl;
 
+  // Baselines for relative deltas, and the latest delta we can acknowledge.
+  SnapshotHistory history;
+  optional<SkySequence> ack;
+  // The latest delta that spawned or killed each plane.
+  std::map<PID, SkySequence> lives;
+
+  // Remote planes' states as they're released, for rendering smoothly.
+  InterpolationBuffer interpolation;
+  void recordStates(const Sky &sky, const TimedMessage<SkyDelta> &delta);
+
   struct Stats {
     TimeDiff averageWait, actualJitter;
+    TimeDiff estimatedJitter, offsetError;
+    double skew;
+    TimeDiff delay;
+    FlowStats flow;
   };
   optional<Stats> stats;
 
@@ -44,7 +60,13 @@ class SkyDeltaCache: public Subsystem<Nothing> {
  public:
   SkyDeltaCache(Arena &arena, SkyHandle &skyHandle);
 
-  void receive(const Time timestamp, const SkyDelta &delta);
+  void receive(const Time timestamp,
+               const SkySequence sequence,
+               const optional<SkySequence> &baseline,
+               SkyDelta &&delta);
+  optional<SkySequence> getAck() const;
+  const InterpolationBuffer &getInterpolation() const;
+  void reset();
 
   void printDebug(Printer &p);
 
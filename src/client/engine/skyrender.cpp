@@ -71,6 +71,16 @@ void PlaneGraphics::onKill() {
  * RenderSystem.
  */
 
+PhysicalState SkyRender::renderedState(
+    const Participation &participation) const {
+  if (interpolation) {
+    if (const auto state = interpolation->sample(
+        participation.player.pid, arena.getUptime(), interpolationDelay))
+      return state.get();
+  }
+  return participation.plane->getState().physical;
+}
+
 float SkyRender::findView(
     const float viewWidth,
     const float totalWidth,
@@ -109,14 +119,15 @@ void SkyRender::renderPlaneGraphics(ui::Frame &f,
   if (auto &plane = graphics.participation.plane) {
     auto &state = plane->getState();
     auto &tuning = plane->getTuning();
+    const PhysicalState physical = renderedState(graphics.participation);
 
     const float scaleFactor = style.skyRender.planeGraphicsScale
         * tuning.hitbox.x / 200;
 
     f.withTransform(
         sf::Transform()
-            .translate(state.physical.pos)
-            .rotate(state.physical.rot), [&]() {
+            .translate(physical.pos)
+            .rotate(physical.rot), [&]() {
 
       f.withTransform(sf::Transform().scale(scaleFactor, scaleFactor), [&]() {
         // Plane graphics, scaled down so the plane's length is 200 px from this perspective.
@@ -135,7 +146,7 @@ void SkyRender::renderPlaneGraphics(ui::Frame &f,
       }
     });
 
-    f.withTransform(sf::Transform().translate(state.physical.pos), [&]() {
+    f.withTransform(sf::Transform().translate(physical.pos), [&]() {
       const float airspeedStall = tuning.flight.threshold /
           tuning.flight.airspeedFactor;
       f.drawText({0, -style.skyRender.barArea.top - style.base.normalFontSize},
@@ -181,15 +192,18 @@ void SkyRender::renderMap(ui::Frame &f) {
 SkyRender::SkyRender(ClientShared &shared,
                      const ui::AppResources &resources,
                      Arena &arena,
-                     const Sky &sky) :
+                     const Sky &sky,
+                     const InterpolationBuffer *interpolation) :
     ClientComponent(shared),
     Subsystem(arena),
     sky(sky),
+    interpolation(interpolation),
     resources(resources),
     sheet(ui::TextureID::PlayerSheet),
     planeSheet(resources.getTextureData(sheet).spritesheetForm.get(),
                resources.getTexture(sheet)),
-    enableDebug(shared.references.settings.enableDebug) {
+    enableDebug(shared.references.settings.enableDebug),
+    interpolationDelay(shared.references.settings.interpolationDelay) {
   arena.forPlayers([&](Player &player) { registerPlayer(player); });
 }
 
@@ -222,6 +236,8 @@ void SkyRender::onKill(Player &player) {
 
 void SkyRender::onChangeSettings(const ui::SettingsDelta &settings) {
   if (settings.enableDebug) enableDebug = settings.enableDebug.get();
+  if (settings.interpolationDelay)
+    interpolationDelay = settings.interpolationDelay.get();
 }
 
 void SkyRender::render(ui::Frame &f, const sf::Vector2f &pos) {
@@ -26,6 +26,7 @@
 #include "ui/control.hpp"
 #include "ui/sheet.hpp"
 #include "engine/sky/sky.hpp"
+#include "engine/sky/interpolation.hpp"
 
 namespace sky {
 
@@ -59,6 +60,7 @@ class SkyRender
  private:
   // Parameters.
   const Sky &sky;
+  const InterpolationBuffer *interpolation; // for remote planes, if any
 
   // State.
   std::map<PID, PlaneGraphics> graphics;
@@ -69,6 +71,7 @@ class SkyRender
   const ui::SpriteSheet planeSheet;
 
   // Render submethods.
+  PhysicalState renderedState(const Participation &participation) const;
   float findView(const float viewWidth,
                  const float totalWidth,
                  const float viewTarget) const;
@@ -91,7 +94,8 @@ class SkyRender
   SkyRender(ClientShared &shared,
             const ui::AppResources &resources,
             Arena &arena,
-            const Sky &sky);
+            const Sky &sky,
+            const InterpolationBuffer *interpolation = nullptr);
 
   // ClientComponent impl.
   void onChangeSettings(const ui::SettingsDelta &settings) override final;
@@ -99,6 +103,7 @@ class SkyRender
   // User API.
   void render(ui::Frame &f, const sf::Vector2f &pos);
   bool enableDebug;
+  TimeDiff interpolationDelay;
 };
 
 }
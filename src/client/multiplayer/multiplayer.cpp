@@ -102,6 +102,7 @@ void Multiplayer::printDebugLeft(Printer &p) {
                   + printKbps(core.getHost().incomingBandwidth()));
     p.printLn("outbound bandwidth (kB/s): "
                   + printKbps(core.getHost().outgoingBandwidth()));
+    core.printNetworkStats(p);
   } else {
     p.printLn("not connected...");
   }
@@ -91,7 +91,7 @@ void MultiplayerCore::onEndGame() {
   askedSky = false;
 }
 
-void MultiplayerCore::processPacket(const sky::ServerPacket &packet) {
+void MultiplayerCore::processPacket(sky::ServerPacket &&packet) {
   using namespace sky;
 
   if (!conn) {
@@ -120,9 +120,10 @@ void MultiplayerCore::processPacket(const sky::ServerPacket &packet) {
     case ServerPacket::Type::InitSky: {
       auto &skyHandle = conn->skyHandle;
       if (skyHandle.getEnvironment() and
-          skyHandle.getEnvironment()->getVisuals())
+          skyHandle.getEnvironment()->getVisuals()) {
         skyHandle.instantiateSky(packet.skyInit.get());
-      else {
+        conn->skyDeltaCache.reset();
+      } else {
         appLog("InitSky packet received before we have loaded! "
                   "The server is at fault and likely broken.", LogOrigin::Error);
       }
@@ -130,8 +131,10 @@ void MultiplayerCore::processPacket(const sky::ServerPacket &packet) {
     }
 
     case ServerPacket::Type::Ping: {
+      // The server rewinds our shots by how far behind we render.
       transmit(sky::ClientPacket::Pong(
-          packet.timestamp.get(), conn->arena.getUptime()));
+          packet.timestamp.get(), conn->arena.getUptime(),
+          shared.references.settings.interpolationDelay));
       break;
     }
 
@@ -147,7 +150,10 @@ void MultiplayerCore::processPacket(const sky::ServerPacket &packet) {
 
     case ServerPacket::Type::DeltaSky: {
       if (conn->skyHandle.getSky()) {
-        conn->skyDeltaCache.receive(packet.timestamp.get(), packet.skyDelta.get());
+        conn->skyDeltaCache.receive(packet.timestamp.get(),
+                                    packet.skySequence.get(),
+                                    packet.skyBaseline,
+                                    std::move(packet.skyDelta.get()));
       } else {
         appLog("Received sky delta packet before sky was initialized! "
                    "The server is at fault and is likely broken.", LogOrigin::Error);
@@ -209,8 +215,10 @@ bool MultiplayerCore::pollNetwork() {
     }
   } else {
     if (event.type == ENET_EVENT_TYPE_RECEIVE) {
-      if (const auto reception = telegraph.receive(event.packet))
-        processPacket(*reception);
+      telegraph.receive(event.packet, [&](sky::ServerPacket &&packet) {
+        processPacket(std::move(packet));
+      });
+      enet_packet_destroy(event.packet);
     }
   }
 
@@ -235,7 +243,9 @@ MultiplayerCore::MultiplayerCore(
     disconnecting(false),
     disconnected(false),
 
-    participationUpdateSchedule(1.0f / 25.0f),
+    inputRate(1.0f / 60.0f, 1.0f / 15.0f, 1.0f / 25.0f),
+    linkSchedule(0.5f),
+    skyAckSchedule(1.0f / 10.0f),
 
     messageInteraction(shared.references),
     enginePrinter(messageInteraction),
@@ -253,6 +263,13 @@ const tg::Host &MultiplayerCore::getHost() const {
   return host;
 }
 
+void MultiplayerCore::printNetworkStats(Printer &p) const {
+  if (server) {
+    if (const auto stats = host.peerStats(server)) p.printLn(stats.get());
+  }
+  telegraph.traffic.print(p);
+}
+
 bool MultiplayerCore::isConnected() const {
   return bool(server);
 }
@@ -276,7 +293,11 @@ void MultiplayerCore::onChangeSettings(const ui::SettingsDelta &settings) {
   }
 }
 
-void MultiplayerCore::transmit(const sky::ClientPacket &packet) {
+void MultiplayerCore::transmit(sky::ClientPacket packet) {
+  if (conn) {
+    packet.skyAck = conn->skyDeltaCache.getAck();
+    transmittedAck = packet.skyAck;
+  }
   if (server) telegraph.transmit(host, server, packet);
 }
 
@@ -312,17 +333,38 @@ void MultiplayerCore::tick(const float delta) {
   if (conn) {
     conn->arena.tick(delta);
 
-    // Sending scheduled participation inputs.
+    // Adapting the input rate to the link.
+    if (linkSchedule.tick(delta)) {
+      if (server) inputRate.update(tg::LinkQuality(server));
+      linkSchedule.reset();
+    }
+
+    // Sending participation inputs: at once when controls change, at the
+    // adaptive rate otherwise. They go unreliably, so control changes are
+    // repeated in the next few. The server acknowledges them in its deltas,
+    // which is what we reconcile our plane's prediction against.
     if (const auto &sky = conn->skyHandle.getSky()) {
-      if (participationUpdateSchedule.tick(delta)) {
-        const auto input = sky->getParticipation(conn->player).collectInput();
-        if (input) {
-          transmit(sky::ClientPacket::ReqInput(input.get(), conn->arena.getUptime()));
-          participationUpdateSchedule.reset();
+      inputRate.tick(delta);
+      auto &participation = sky->getParticipation(conn->player);
+      if (inputRate.due() or participation.controlsChanged()) {
+        if (const auto input = participation.collectInput()) {
+          const auto inputs =
+              inputStream.push(input.get(), conn->arena.getUptime());
+          transmit(sky::ClientPacket::ReqInput(inputs));
+          participation.predictInput(inputs.back().sequence);
+          inputRate.reset();
         }
       }
     }
 
+    // Acknowledging sky deltas, if no other packet has done it for us.
+    if (skyAckSchedule.tick(delta)) {
+      const auto ack = conn->skyDeltaCache.getAck();
+      if (ack and ack != transmittedAck)
+        transmit(sky::ClientPacket::AckSky(ack.get()));
+      skyAckSchedule.reset();
+    }
+
     if (const auto &env = conn->skyHandle.getEnvironment()) {
       if (!conn->skyHandle.getSky()) {
         // We want to ask for the Sky.
@@ -134,10 +134,13 @@ class MultiplayerCore: public ClientComponent {
   void onEndGame();
 
   // Transmission timers.
-  Scheduler participationUpdateSchedule;
+  tg::RateControl inputRate; // adapts to the link to the server
+  sky::InputStream inputStream;
+  Scheduler linkSchedule, skyAckSchedule;
+  optional<sky::SkySequence> transmittedAck;
 
   // Packet processing submethod.
-  void processPacket(const sky::ServerPacket &packet);
+  void processPacket(sky::ServerPacket &&packet);
   // (returns true when the queue has been exhausted)
   bool pollNetwork();
 
@@ -158,6 +161,7 @@ class MultiplayerCore: public ClientComponent {
   // Connection state.
   optional<ArenaConnection> conn;
   const tg::Host &getHost() const;
+  void printNetworkStats(Printer &p) const; // link and traffic telemetry
   bool isConnected() const;
   bool isDisconnecting() const;
   bool isDisconnected() const;
@@ -166,7 +170,7 @@ class MultiplayerCore: public ClientComponent {
   void onChangeSettings(const ui::SettingsDelta &settings);
 
   // User API.
-  void transmit(const sky::ClientPacket &packet);
+  void transmit(sky::ClientPacket packet);
   void disconnect();
   void poll();
   void tick(const TimeDiff delta);
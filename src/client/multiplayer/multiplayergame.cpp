@@ -82,7 +82,8 @@ MultiplayerGame::MultiplayerGame(
     ClientShared &shared, MultiplayerCore &core) :
     MultiplayerView(shared, core),
     scoreboardFocused(false),
-    skyRender(shared, resources, conn.arena, *conn.getSky()),
+    skyRender(shared, resources, conn.arena, *conn.getSky(),
+              &conn.skyDeltaCache.getInterpolation()),
     participation(conn.getSky()->getParticipation(conn.player)) {
   assert(bool(conn.skyHandle.getSky()));
   assert(bool(conn.skyHandle.getEnvironment()));
@@ -288,6 +288,7 @@ Arena::Arena(const ArenaInit &initializer, const optional<PID> isClient, const b
     uptime(0),
     teamCount(initializer.teamCount),
     debugTimer(2),
+    random(std::random_device()()),
     role(isClient, isSandbox),
     subsystemCaller(*this) {
   for (auto const &player : initializer.players) {
@@ -432,7 +433,7 @@ Team Arena::autojoinTeam() const {
   } else if (blues > reds) {
     return sky::Team::Blue;
   } else {
-    return static_cast<sky::Team>((std::rand() % getTeamCount()) + 1);
+    return static_cast<sky::Team>((random() % getTeamCount()) + 1);
   }
 }
 
@@ -22,6 +22,7 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <random>
 #include "util/types.hpp"
 #include "util/methods.hpp"
 #include "player.hpp"
@@ -265,6 +266,10 @@ class Arena: public Networked<ArenaInit, ArenaDelta> {
   int teamCount;
   Scheduler debugTimer;
 
+  // Our own generator: the server ticks arenas in parallel, and std::rand's
+  // state is shared between them.
+  mutable std::mt19937 random;
+
   // Managing players.
   Player &joinPlayer(const PlayerInitializer &initializer);
   void quitPlayer(Player &player);
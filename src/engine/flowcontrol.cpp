@@ -15,25 +15,131 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <limits>
 #include "flowcontrol.hpp"
 #include "util/methods.hpp"
 
 namespace sky {
 
+/**
+ * ReleasePolicy.
+ */
+
+ReleasePolicy::ReleasePolicy(const bool skipLate) :
+    skipLate(skipLate) {}
+
+void ReleasePolicy::registerLateness(const ClockSync &, const TimeDiff) {}
+
+/**
+ * ImmediatePolicy.
+ */
+
+ImmediatePolicy::ImmediatePolicy() :
+    ReleasePolicy(false) {}
+
+TimeDiff ImmediatePolicy::delay(const ClockSync &) const {
+  return -std::numeric_limits<TimeDiff>::infinity();
+}
+
+/**
+ * MarginPolicy.
+ */
+
+MarginPolicy::MarginPolicy() :
+    ReleasePolicy(false) {}
+
+TimeDiff MarginPolicy::delay(const ClockSync &sync) const {
+  return 2 * sync.jitter() + sync.error();
+}
+
+/**
+ * AdaptivePolicy.
+ */
+
+AdaptivePolicy::AdaptivePolicy(const float percentile,
+                               const unsigned int window,
+                               const float attack,
+                               const float decay) :
+    ReleasePolicy(true),
+    // 5 ms buckets: the percentile is read on every arrival, so it mustn't
+    // copy and sort the window.
+    lateness(window, 0, 0.5, 100),
+    target(0),
+    percentile(percentile),
+    attack(attack),
+    decay(decay) {}
+
+void AdaptivePolicy::registerLateness(const ClockSync &,
+                                      const TimeDiff lateness) {
+  this->lateness.push(lateness);
+
+  // A few late arrivals in a row mean the route got worse, so we follow at
+  // once; a quiet spell might not last, so we wind down slowly.
+  const TimeDiff wanted = this->lateness.percentile(percentile);
+  if (wanted > target) target += attack * (wanted - target);
+  else target += decay * (wanted - target);
+}
+
+TimeDiff AdaptivePolicy::delay(const ClockSync &) const {
+  return target;
+}
+
+/**
+ * FlowStats.
+ */
+
+FlowStats::FlowStats() :
+    arrivals(0),
+    underruns(0),
+    avoided(0) {}
+
 /**
  * FlowState.
  */
 
-FlowState::FlowState() :
-  offsets(100) {}
+FlowState::FlowState(std::unique_ptr<ReleasePolicy> &&policy) :
+    sync(100, 10),
+    policy(std::move(policy)) {}
+
+bool FlowState::registerArrival(const Time localtime, const Time timestamp) {
+  sync.registerArrival(timestamp, localtime);
 
-void FlowState::registerArrival(const Time offset) {
-  offsets.push(offset);
+  // Measured against the delay the policy asked for before this arrival;
+  // anything within the offset's error isn't really late.
+  const TimeDiff late = lateness(localtime, timestamp);
+  const TimeDiff delay = getDelay();
+  stats.arrivals++;
+  if (late > sync.error()) {
+    if (late > delay) stats.underruns++;
+    else stats.avoided++;
+  }
+
+  policy->registerLateness(sync, late);
+  return release(localtime, timestamp);
+}
+
+TimeDiff FlowState::lateness(const Time localtime, const Time timestamp) const {
+  return TimeDiff(localtime - timestamp + sync.offset(localtime));
+}
+
+bool FlowState::release(const Time localtime, const Time timestamp) const {
+  return lateness(localtime, timestamp) >= getDelay();
 }
 
-bool FlowState::release(const Time offset) {
-  return offset > offsets.max();
+const ReleasePolicy &FlowState::getPolicy() const {
+  return *policy;
 }
 
+const ClockSync &FlowState::getSync() const {
+  return sync;
 }
 
+const FlowStats &FlowState::getStats() const {
+  return stats;
+}
+
+TimeDiff FlowState::getDelay() const {
+  return policy->delay(sync);
+}
+
+}
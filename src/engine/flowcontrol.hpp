@@ -19,24 +19,114 @@
  * Buffer timestamped message streams, pulling from them with constant timeflow rate.
  */
 #pragma once
-#include <queue>
+#include <algorithm>
+#include <deque>
+#include <memory>
 #include "util/types.hpp"
 #include "util/printer.hpp"
+#include "util/clocksync.hpp"
 
 namespace sky {
 
+/**
+ * Decides how long a flow buffers its messages. It's fed the lateness of
+ * each arrival: how much longer it took than the least delayed recent ones.
+ * A message is released once it's as late as the delay the policy asks for.
+ */
+class ReleasePolicy {
+ public:
+  ReleasePolicy(const bool skipLate);
+  virtual ~ReleasePolicy() { }
+
+  // Messages that arrive already due go out ahead of the ones still held.
+  const bool skipLate;
+
+  virtual void registerLateness(const ClockSync &sync, const TimeDiff lateness);
+  virtual TimeDiff delay(const ClockSync &sync) const = 0;
+
+};
+
+/**
+ * Release messages as soon as they arrive.
+ */
+class ImmediatePolicy: public ReleasePolicy {
+ public:
+  ImmediatePolicy();
+
+  TimeDiff delay(const ClockSync &sync) const override;
+
+};
+
+/**
+ * Wait out a margin of twice the estimated jitter, plus the error of the
+ * offset estimate.
+ */
+class MarginPolicy: public ReleasePolicy {
+ public:
+  MarginPolicy();
+
+  TimeDiff delay(const ClockSync &sync) const override;
+
+};
+
+/**
+ * Adaptive jitter buffer: the delay tracks a percentile of recent lateness,
+ * jumping up to it as soon as it rises and drifting down when it falls.
+ * Arrivals later than that skip the buffer rather than holding it back.
+ */
+class AdaptivePolicy: public ReleasePolicy {
+ private:
+  RollingSampler<TimeDiff> lateness;
+  TimeDiff target;
+
+ public:
+  AdaptivePolicy(const float percentile = 0.95,
+                 const unsigned int window = 100,
+                 const float attack = 1,
+                 const float decay = 0.01);
+
+  const float percentile; // of arrivals that should be on time
+  const float attack, decay; // how far to move per arrival, up and down
+
+  void registerLateness(const ClockSync &sync,
+                        const TimeDiff lateness) override;
+  TimeDiff delay(const ClockSync &sync) const override;
+
+};
+
+/**
+ * What buffering a flow did, and what it got for it.
+ */
+struct FlowStats {
+  FlowStats();
+
+  size_t arrivals;
+  size_t underruns; // arrived after they were due
+  size_t avoided; // late against the least delayed, but held back in time
+
+};
+
 /**
  * Manages statistics of a flow, resulting in a decision procedure for releasing messages from the cache.
  */
 class FlowState {
  private:
-  RollingSampler<Time> offsets;
+  ClockSync sync; // the upstream clock, as the arrivals tell it
+  std::unique_ptr<ReleasePolicy> policy;
+  FlowStats stats;
 
  public:
-  FlowState();
+  FlowState(std::unique_ptr<ReleasePolicy> &&policy);
+
+  // Returns whether the message is already due.
+  bool registerArrival(const Time localtime, const Time timestamp);
+  TimeDiff lateness(const Time localtime, const Time timestamp) const;
+  bool release(const Time localtime, const Time timestamp) const;
 
-  void registerArrival(const Time offset);
-  bool release(const Time offset);
+  const ReleasePolicy &getPolicy() const;
+  const ClockSync &getSync() const;
+  const FlowStats &getStats() const;
+  TimeDiff getDelay() const;
 
 };
 
@@ -47,6 +137,8 @@ template<typename Message>
 struct TimedMessage {
   TimedMessage(const Message &message, const Time arrivalTime, const Time timestamp) :
     message(message), arrivalTime(arrivalTime), timestamp(timestamp) {}
+  TimedMessage(Message &&message, const Time arrivalTime, const Time timestamp) :
+    message(std::move(message)), arrivalTime(arrivalTime), timestamp(timestamp) {}
 
   Message message;
   Time arrivalTime, timestamp;
@@ -61,34 +153,64 @@ struct TimedMessage {
 template<typename Message>
 class FlowControl {
  private:
-  std::queue<TimedMessage<Message>> messages;
+  std::deque<TimedMessage<Message>> messages;
   FlowState flowState;
 
+  void enqueue(TimedMessage<Message> &&message) {
+    const bool due = flowState.registerArrival(message.arrivalTime,
+                                               message.timestamp);
+    if (due and flowState.getPolicy().skipLate) {
+      // Ahead of everything still held back, behind what's already due.
+      const Time localtime = message.arrivalTime;
+      const auto held = std::find_if(
+          messages.begin(), messages.end(),
+          [&](const TimedMessage<Message> &queued) {
+            return !flowState.release(localtime, queued.timestamp);
+          });
+      messages.insert(held, std::move(message));
+    } else {
+      messages.push_back(std::move(message));
+    }
+  }
+
  public:
-  FlowControl() :
+  FlowControl(std::unique_ptr<ReleasePolicy> &&policy =
+                  std::make_unique<AdaptivePolicy>()) :
+    flowState(std::move(policy)),
     waitingTime(50),
     offsets(50) {}
 
   // A message with a timestamp arrives.
   void registerMessage(const Time localtime, const Time timestamp, const Message &message) {
-    flowState.registerArrival(localtime - timestamp);
-    messages.push(TimedMessage<Message>(message, localtime, timestamp));
+    enqueue(TimedMessage<Message>(message, localtime, timestamp));
+  }
+
+  void registerMessage(const Time localtime, const Time timestamp, Message &&message) {
+    enqueue(TimedMessage<Message>(std::move(message), localtime, timestamp));
   }
 
   void registerArrival(const Time localtime, const Time timestamp) {
-    flowState.registerArrival(localtime - timestamp);
+    flowState.registerArrival(localtime, timestamp);
   }
 
   // Potentially pull a message, given the current localtime.
+  // The message is moved out of the cache.
   optional<Message> pull(const Time localtime) {
+    if (auto released = pullTimed(localtime))
+      return optional<Message>(std::move(released->message));
+    return {};
+  }
+
+  // Same, keeping the message's timestamp.
+  optional<TimedMessage<Message>> pullTimed(const Time localtime) {
     if (!messages.empty()) {
-      const Time difference = localtime - messages.front().timestamp;
-      if (flowState.release(difference)) {
-        const auto msg = messages.front();
+      if (flowState.release(localtime, messages.front().timestamp)) {
+        auto &msg = messages.front();
         waitingTime.push(localtime - msg.arrivalTime);
         offsets.push(localtime - msg.timestamp);
-        messages.pop();
-        return {msg.message};
+        optional<TimedMessage<Message>> released(std::move(msg));
+        messages.pop_front();
+        return released;
       }
     }
 
@@ -96,7 +218,20 @@ class FlowControl {
   }
 
   void reset() {
-    if (!messages.empty()) messages = std::queue<TimedMessage<Message>>();
+    messages.clear();
+  }
+
+  const ClockSync &getSync() const {
+    return flowState.getSync();
+  }
+
+  const FlowStats &getStats() const {
+    return flowState.getStats();
+  }
+
+  // How late, past the least delayed arrivals, messages are held until.
+  TimeDiff getDelay() const {
+    return flowState.getDelay();
   }
 
   RollingSampler<TimeDiff> waitingTime;
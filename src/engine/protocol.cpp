@@ -30,15 +30,17 @@ ClientPacket::ClientPacket(const Type type) : type(type) { }
 bool ClientPacket::verifyStructure() const {
   switch (type) {
     case Type::Pong:
-      return verifyRequiredOptionals(pingTime, pongTime);
+      return verifyRequiredOptionals(pingTime, pongTime, viewDelay);
     case Type::ReqJoin:
-      return verifyRequiredOptionals(stringData);
+      return verifyRequiredOptionals(stringData, arena);
     case Type::ReqSky:
       return true;
     case Type::ReqPlayerDelta:
       return verifyRequiredOptionals(playerDelta);
     case Type::ReqInput:
-      return verifyRequiredOptionals(participationInput, timestamp);
+      return verifyRequiredOptionals(inputs) and !inputs->empty();
+    case Type::AckSky:
+      return verifyRequiredOptionals(skyAck);
     case Type::ReqTeam:
       return verifyRequiredOptionals(team);
     case Type::ReqSpawn:
@@ -52,16 +54,20 @@ bool ClientPacket::verifyStructure() const {
 }
 
 ClientPacket ClientPacket::Pong(const Time pingTime,
-                                const Time pongTime) {
+                                const Time pongTime,
+                                const TimeDiff viewDelay) {
   ClientPacket packet(ClientPacket::Type::Pong);
   packet.pingTime = pingTime;
   packet.pongTime = pongTime;
+  packet.viewDelay = viewDelay;
   return packet;
 }
 
-ClientPacket ClientPacket::ReqJoin(const std::string &nickname) {
+ClientPacket ClientPacket::ReqJoin(const std::string &nickname,
+                                  const ArenaID arena) {
   ClientPacket packet(Type::ReqJoin);
   packet.stringData = nickname;
+  packet.arena = arena;
   return packet;
 }
 
@@ -75,11 +81,15 @@ ClientPacket ClientPacket::ReqPlayerDelta(const PlayerDelta &playerDelta) {
   return packet;
 }
 
-ClientPacket ClientPacket::ReqInput(const ParticipationInput &input,
-                                    const Time timestamp) {
+ClientPacket ClientPacket::ReqInput(const std::vector<SequencedInput> &inputs) {
   ClientPacket packet(Type::ReqInput);
-  packet.participationInput = input;
-  packet.timestamp = timestamp;
+  packet.inputs = inputs;
+  return packet;
+}
+
+ClientPacket ClientPacket::AckSky(const SkySequence ack) {
+  ClientPacket packet(Type::AckSky);
+  packet.skyAck = ack;
   return packet;
 }
 
@@ -105,6 +115,35 @@ ClientPacket ClientPacket::RCon(const std::string &command) {
   return packet;
 }
 
+tg::Reliability reliabilityOf(const ClientPacket &packet) {
+  switch (packet.type) {
+    case ClientPacket::Type::Pong:
+      return tg::Reliability::Unsequenced;
+    case ClientPacket::Type::AckSky:
+      return tg::Reliability::Unsequenced;
+    case ClientPacket::Type::ReqInput:
+      return tg::Reliability::UnreliableSequenced; // redundant instead
+    default:
+      return tg::Reliability::ReliableOrdered;
+  }
+}
+
+const char *messageKind(const ClientPacket &packet) {
+  switch (packet.type) {
+    case ClientPacket::Type::Pong: return "Pong";
+    case ClientPacket::Type::ReqJoin: return "ReqJoin";
+    case ClientPacket::Type::ReqSky: return "ReqSky";
+    case ClientPacket::Type::ReqPlayerDelta: return "ReqPlayerDelta";
+    case ClientPacket::Type::ReqInput: return "ReqInput";
+    case ClientPacket::Type::AckSky: return "AckSky";
+    case ClientPacket::Type::ReqTeam: return "ReqTeam";
+    case ClientPacket::Type::ReqSpawn: return "ReqSpawn";
+    case ClientPacket::Type::Chat: return "Chat";
+    case ClientPacket::Type::RCon: return "RCon";
+  }
+  return "unknown";
+}
+
 /**
  * ServerPacket.
  */
@@ -126,7 +165,7 @@ bool ServerPacket::verifyStructure() const {
     case Type::DeltaSkyHandle:
       return verifyRequiredOptionals(skyHandleDelta);
     case Type::DeltaSky:
-      return verifyRequiredOptionals(timestamp, skyDelta);
+      return verifyRequiredOptionals(timestamp, skySequence, skyDelta);
     case Type::DeltaScore:
       return verifyRequiredOptionals(scoreDelta);
     case Type::Chat:
@@ -177,10 +216,14 @@ ServerPacket ServerPacket::DeltaSkyHandle(
 }
 
 ServerPacket ServerPacket::DeltaSky(const SkyDelta &skyDelta,
-                                    const Time pingTime) {
+                                    const Time pingTime,
+                                    const SkySequence sequence,
+                                    const optional<SkySequence> &baseline) {
   ServerPacket packet(Type::DeltaSky);
   packet.skyDelta = skyDelta;
   packet.timestamp = pingTime;
+  packet.skySequence = sequence;
+  packet.skyBaseline = baseline;
   return packet;
 }
 
@@ -209,4 +252,39 @@ ServerPacket ServerPacket::RCon(const std::string &message) {
   return packet;
 }
 
+bool compressible(const ServerPacket &packet) {
+  return packet.type == ServerPacket::Type::Init
+      or packet.type == ServerPacket::Type::InitSky;
+}
+
+const char *messageKind(const ServerPacket &packet) {
+  switch (packet.type) {
+    case ServerPacket::Type::Ping: return "Ping";
+    case ServerPacket::Type::Init: return "Init";
+    case ServerPacket::Type::InitSky: return "InitSky";
+    case ServerPacket::Type::DeltaArena: return "DeltaArena";
+    case ServerPacket::Type::DeltaSkyHandle: return "DeltaSkyHandle";
+    case ServerPacket::Type::DeltaSky: return "DeltaSky";
+    case ServerPacket::Type::DeltaScore: return "DeltaScore";
+    case ServerPacket::Type::Chat: return "Chat";
+    case ServerPacket::Type::Broadcast: return "Broadcast";
+    case ServerPacket::Type::RCon: return "RCon";
+  }
+  return "unknown";
+}
+
+tg::Reliability reliabilityOf(const ServerPacket &packet) {
+  switch (packet.type) {
+    case ServerPacket::Type::Ping:
+      return tg::Reliability::Unsequenced;
+    case ServerPacket::Type::DeltaSky: {
+      if (packet.skyDelta and !packet.skyDelta->carriesEvents())
+        return tg::Reliability::UnreliableSequenced;
+      return tg::Reliability::ReliableOrdered;
+    }
+    default:
+      return tg::Reliability::ReliableOrdered;
+  }
+}
+
 }
@@ -21,23 +21,32 @@
 #pragma once
 #include <map>
 #include "util/types.hpp"
+#include "util/telegraph.hpp"
 #include "scoreboard.hpp"
 #include "sky/skyhandle.hpp"
+#include "sky/snapshothistory.hpp"
+#include "sky/inputstream.hpp"
 #include "arena.hpp"
 
 namespace sky {
 
+/**
+ * Which of a server's arenas a client joins.
+ */
+using ArenaID = unsigned short;
+
 /**
  * Protocol verbs for the client.
  */
 struct ClientPacket : public VerifyStructure {
   enum class Type {
-    Pong, // respond to a server Ping
+    Pong, // respond to a server Ping, with how far behind we render
     ReqJoin, // request joining in the arena, part of the connection protocol
     ReqSky, // request a Sky initializer, having loaded the Environment
 
     ReqPlayerDelta, // request a change to your player data
-    ReqInput, // request an input into your engine Participation
+    ReqInput, // request inputs into your engine Participation, unreliably
+    AckSky, // acknowledge DeltaSky packets, when nothing else carries skyAck
 
     ReqTeam, // request a team change
     ReqSpawn, // request to spawn
@@ -48,14 +57,14 @@ struct ClientPacket : public VerifyStructure {
 
   template<typename Archive>
   void serialize(Archive &ar) {
-    ar(type);
+    ar(type, skyAck);
     switch (type) {
       case Type::Pong: {
-        ar(pingTime, pongTime);
+        ar(pingTime, pongTime, viewDelay);
         break;
       }
       case Type::ReqJoin: {
-        ar(stringData);
+        ar(stringData, arena);
         break;
       }
       case Type::ReqSky: {
@@ -66,9 +75,12 @@ struct ClientPacket : public VerifyStructure {
         break;
       }
       case Type::ReqInput: {
-        ar(participationInput, timestamp);
+        ar(inputs);
         break;
       };
+      case Type::AckSky: {
+        break;
+      }
       case Type::ReqTeam: {
         ar(team);
         break;
@@ -91,26 +103,43 @@ struct ClientPacket : public VerifyStructure {
   ClientPacket(const Type type);
 
   Type type;
-  optional<Time> pingTime, pongTime, timestamp;
+  optional<Time> pingTime, pongTime;
+  optional<TimeDiff> viewDelay; // the client's interpolation delay
   optional<std::string> stringData;
   optional<PlayerDelta> playerDelta;
   optional<Team> team;
-  optional<ParticipationInput> participationInput;
+  optional<std::vector<SequencedInput>> inputs; // oldest first
   optional<bool> state;
+  optional<SkySequence> skyAck; // any packet, latest DeltaSky received
+  optional<ArenaID> arena;
 
   bool verifyStructure() const override;
 
-  static ClientPacket Pong(const Time pingTime, const Time pongTime);
-  static ClientPacket ReqJoin(const std::string &nickname);
+  static ClientPacket Pong(const Time pingTime, const Time pongTime,
+                           const TimeDiff viewDelay);
+  static ClientPacket ReqJoin(const std::string &nickname,
+                              const ArenaID arena = 0);
   static ClientPacket ReqSky();
   static ClientPacket ReqPlayerDelta(const PlayerDelta &playerDelta);
-  static ClientPacket ReqInput(const ParticipationInput &input, const Time timestamp);
+  static ClientPacket ReqInput(const std::vector<SequencedInput> &inputs);
+  static ClientPacket AckSky(const SkySequence ack);
   static ClientPacket ReqTeam(const Team team);
   static ClientPacket ReqSpawn();
   static ClientPacket Chat(const std::string &message);
   static ClientPacket RCon(const std::string &command);
 };
 
+/**
+ * Delivery class of a ClientPacket. Inputs without control changes and
+ * acknowledgements are superseded by the next ones, pongs are time-critical.
+ */
+tg::Reliability reliabilityOf(const ClientPacket &packet);
+
+/**
+ * Name of a ClientPacket's type, for traffic statistics.
+ */
+const char *messageKind(const ClientPacket &packet);
+
 /**
  * Protocol verbs for the server.
  */
@@ -159,7 +188,7 @@ struct ServerPacket : public VerifyStructure {
         break;
       }
       case Type::DeltaSky: {
-        ar(timestamp, skyDelta);
+        ar(timestamp, skySequence, skyBaseline, skyDelta);
         break;
       }
       case Type::DeltaScore: {
@@ -191,6 +220,7 @@ struct ServerPacket : public VerifyStructure {
   optional<ArenaDelta> arenaDelta;         // DeltaArena
   optional<SkyHandleDelta> skyHandleDelta; // DeltaSkyHandle
   optional<SkyDelta> skyDelta;             // DeltaSky
+  optional<SkySequence> skySequence, skyBaseline;
   optional<Time> timestamp;
   optional<ScoreboardDelta> scoreDelta;    // DeltaScore
   optional<std::string> stringData; // Chat, Broadcast, RCon
@@ -206,7 +236,9 @@ struct ServerPacket : public VerifyStructure {
   static ServerPacket DeltaArena(const ArenaDelta &arenaDelta);
   static ServerPacket DeltaSkyHandle(const SkyHandleDelta &skyhandleDelta);
   static ServerPacket DeltaSky(const SkyDelta &skyDelta,
-                               const Time pingTime);
+                               const Time pingTime,
+                               const SkySequence sequence,
+                               const optional<SkySequence> &baseline = {});
   static ServerPacket DeltaScore(const ScoreboardDelta &scoreDelta);
   static ServerPacket Chat(const PID pid, const std::string &chat);
   static ServerPacket Broadcast(const std::string &broadcast);
@@ -214,4 +246,21 @@ struct ServerPacket : public VerifyStructure {
 
 };
 
+/**
+ * Delivery class of a ServerPacket. Sky deltas that only carry state are
+ * superseded by the next ones, pings are time-critical.
+ */
+tg::Reliability reliabilityOf(const ServerPacket &packet);
+
+/**
+ * Initializers grow with the number of players and components, and are
+ * worth compressing.
+ */
+bool compressible(const ServerPacket &packet);
+
+/**
+ * Name of a ServerPacket's type, for traffic statistics.
+ */
+const char *messageKind(const ServerPacket &packet);
+
 }
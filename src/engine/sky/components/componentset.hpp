@@ -39,6 +39,51 @@ using ComponentSetDelta = std::pair<
     std::map<PID, typename Data::InitType>,
     std::map<PID, optional<typename Data::DeltaType>>>;
 
+/**
+ * Whether a delta for a ComponentSet has to arrive. Creations do; removals
+ * are also communicated by every later delta for the set, unless the set
+ * became empty.
+ */
+template<typename Data>
+bool carriesEvents(const ComponentSetDelta<Data> &delta) {
+  return !delta.first.empty() or delta.second.empty();
+}
+
+/**
+ * Strip the element deltas from a ComponentSetDelta, keeping creations and
+ * removals.
+ */
+template<typename Data>
+void dropState(ComponentSetDelta<Data> &delta) {
+  for (auto &element : delta.second) element.second.reset();
+}
+
+/**
+ * Fold a later ComponentSetDelta into an earlier one, so that applying the
+ * result has the effect of applying both. Membership is the later one's;
+ * elements it has no change for keep the earlier change.
+ */
+template<typename Data>
+void absorb(ComponentSetDelta<Data> &delta,
+            const ComponentSetDelta<Data> &later) {
+  auto &inits = delta.first;
+  for (auto init = inits.begin(); init != inits.end();) {
+    if (later.second.count(init->first)) ++init;
+    else init = inits.erase(init);
+  }
+  inits.insert(later.first.begin(), later.first.end());
+
+  std::map<PID, optional<typename Data::DeltaType>> elements;
+  for (const auto &element : later.second) {
+    const auto earlier = delta.second.find(element.first);
+    if (!element.second and earlier != delta.second.end()
+        and !later.first.count(element.first))
+      elements.emplace(element.first, earlier->second);
+    else elements.emplace(element);
+  }
+  delta.second = std::move(elements);
+}
+
 template<typename Data>
 struct Components;
 
@@ -69,6 +114,9 @@ class ComponentSet:
   std::map<PID, std::pair<bool, Data>> data;
   // The bool tracks whether we've sent initializers through the delta collection yet. 'false' means we haven't.
 
+  // Removals are only communicated by absence from a delta, so we have to send one when they happen.
+  bool removedSinceCollection{false};
+
   // This is private. Removal should be accomplished through the destroy() flag.
   void remove(const PID pid) {
     auto x = data.find(pid);
@@ -114,7 +162,7 @@ class ComponentSet:
 
   void forData(std::function<void(Data &, const PID)> f) {
     for (auto &data: data) {
-      f(data.second.second, data.second.first);
+      f(data.second.second, data.first);
     }
   }
 
@@ -129,6 +177,7 @@ class ComponentSet:
     for (const PID pid: removable) {
       remove(pid);
     }
+    removedSinceCollection |= !removable.empty();
   }
 
   // Networked impl + Args... .
@@ -142,7 +191,9 @@ class ComponentSet:
       const auto entityDelta = deltas.find(iter->first);
       if (entityDelta == deltas.end()) {
         iter->second.second.destroy();
-      } 
+      } else if (entityDelta->second) {
+        iter->second.second.applyDelta(entityDelta->second.get());
+      }
       ++iter;
     }
     applyDestruction();
@@ -168,7 +219,8 @@ class ComponentSet:
 
   optional<ComponentSetDelta<Data>> collectDelta() {
     ComponentSetDelta<Data> delta;
-    bool useful{false};
+    bool useful{removedSinceCollection};
+    removedSinceCollection = false;
 
     // Initializers for uninitialized components.
     for (auto &datum: data) {
@@ -19,6 +19,8 @@
 
 namespace sky {
 
+constexpr unsigned int Entity::refreshInterval;
+
 /**
  * EntityState.
  */
@@ -50,7 +52,8 @@ void Entity::postPhysics(const TimeDiff delta) {
 
 Entity::Entity(const EntityState &state, Physics &physics) :
     Component(state, physics),
-    body(physics.createBody(state.shape, BodyTag::EntityTag(*this))) {
+    body(physics.createBody(state.shape, BodyTag::EntityTag(*this))),
+    staleCollections(0) {
   state.physical.hardWriteToBody(physics, body);
   body->SetGravityScale(0);
 }
@@ -64,6 +67,11 @@ void Entity::applyDelta(const EntityDelta &delta) {
 }
 
 optional<EntityDelta> Entity::collectDelta() {
+  if (lastCollected and lastCollected.get() == state.physical
+      and ++staleCollections < refreshInterval) return {};
+
+  staleCollections = 0;
+  lastCollected = state.physical;
   EntityDelta delta;
   delta.physical = state.physical;
   return delta;
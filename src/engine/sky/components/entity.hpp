@@ -78,6 +78,12 @@ class Entity: public Component<EntityState, EntityDelta> {
  private:
   b2Body *const body;
 
+  // Delta collection: only send the physical state when it changes, with a
+  // periodic refresh in case the client's simulation drifts.
+  static constexpr unsigned int refreshInterval = 25;
+  optional<PhysicalState> lastCollected;
+  unsigned int staleCollections;
+
  protected:
   // Component impl.
   void prePhysics() override final;
@@ -0,0 +1,63 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "inputstream.hpp"
+
+namespace sky {
+
+/**
+ * InputStream.
+ */
+
+InputStream::InputStream(const size_t redundancy) :
+    nextSequence(0),
+    redundancy(redundancy) { }
+
+std::vector<SequencedInput> InputStream::push(const ParticipationInput &input,
+                                              const Time timestamp) {
+  std::vector<SequencedInput> inputs;
+  for (auto &repeat : repeats) {
+    inputs.push_back(repeat.input);
+    repeat.sendsLeft--;
+  }
+  while (!repeats.empty() and repeats.front().sendsLeft == 0)
+    repeats.pop_front();
+
+  const InputSequence sequence = nextSequence++;
+  inputs.emplace_back(sequence, timestamp, input);
+
+  if (input.controls and redundancy > 0) {
+    ParticipationInput controls;
+    controls.controls = input.controls;
+    repeats.push_back({SequencedInput(sequence, timestamp, controls),
+                       redundancy});
+  }
+
+  return inputs;
+}
+
+/**
+ * InputFilter.
+ */
+
+bool InputFilter::accept(const SequencedInput &input) {
+  if (last and input.sequence <= last.get()) return false;
+  last = input.sequence;
+  return true;
+}
+
+}
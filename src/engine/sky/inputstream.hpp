@@ -0,0 +1,66 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Numbered, redundant ParticipationInput streams, for sending inputs unreliably.
+ */
+#pragma once
+#include <deque>
+#include "participation.hpp"
+
+namespace sky {
+
+/**
+ * Client side. Numbers inputs, and repeats each control change in the next
+ * few inputs we send, so losing a packet doesn't lose it. Plane states
+ * aren't repeated: only the latest one matters.
+ */
+class InputStream {
+ private:
+  struct Repeat {
+    SequencedInput input;
+    size_t sendsLeft;
+  };
+
+  InputSequence nextSequence;
+  std::deque<Repeat> repeats;
+
+ public:
+  InputStream(const size_t redundancy = 3);
+
+  const size_t redundancy; // how many more packets repeat a control change
+
+  // What to send for a new input, oldest first.
+  std::vector<SequencedInput> push(const ParticipationInput &input,
+                                   const Time timestamp);
+};
+
+/**
+ * Server side. Passes each input of a stream on once, however many packets
+ * repeated it, and never after a newer one.
+ */
+class InputFilter {
+ private:
+  optional<InputSequence> last;
+
+ public:
+  InputFilter() = default;
+
+  bool accept(const SequencedInput &input);
+};
+
+}
@@ -0,0 +1,104 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "interpolation.hpp"
+
+namespace sky {
+
+PhysicalState interpolate(const PhysicalState &from,
+                          const PhysicalState &to,
+                          const float t) {
+  PhysicalState state;
+  state.pos = from.pos + t * (to.pos - from.pos);
+  state.vel = from.vel + t * (to.vel - from.vel);
+  state.rot = float(from.rot)
+      + t * cyclicDistance(Cyclic(0, 360, from.rot), to.rot);
+  state.rotvel = from.rotvel + t * (to.rotvel - from.rotvel);
+  return state;
+}
+
+static PhysicalState extrapolate(const PhysicalState &from,
+                                 const TimeDiff delta) {
+  PhysicalState state{from};
+  state.pos += delta * from.vel;
+  state.rot += delta * from.rotvel;
+  return state;
+}
+
+/**
+ * InterpolationBuffer.
+ */
+
+InterpolationBuffer::InterpolationBuffer(const size_t depth,
+                                         const TimeDiff extrapolationLimit) :
+    depth(depth),
+    extrapolationLimit(extrapolationLimit) { }
+
+void InterpolationBuffer::record(const Time localtime, const Time timestamp,
+                                 const PID pid, const PhysicalState &state) {
+  if (!lastTimestamp or timestamp > lastTimestamp.get()) {
+    sync.registerArrival(timestamp, localtime);
+    lastTimestamp = timestamp;
+  }
+
+  auto &snapshots = bodies[pid];
+  if (!snapshots.empty() and timestamp <= snapshots.back().timestamp) return;
+  snapshots.push_back({timestamp, state});
+  if (snapshots.size() > depth) snapshots.pop_front();
+}
+
+void InterpolationBuffer::forget(const PID pid) {
+  bodies.erase(pid);
+}
+
+void InterpolationBuffer::clear() {
+  bodies.clear();
+  sync.reset();
+  lastTimestamp.reset();
+  playhead.reset();
+}
+
+optional<PhysicalState> InterpolationBuffer::sample(
+    const PID pid, const Time localtime, const TimeDiff delay) const {
+  const auto body = bodies.find(pid);
+  if (!sync.ready() or body == bodies.end() or body->second.empty()) return {};
+
+  const auto &snapshots = body->second;
+  Time time = localtime + sync.offset(localtime) - delay;
+  if (playhead and time < playhead.get()) time = playhead.get();
+  else playhead = time;
+
+  // Before the first snapshot we have, it's the best we can do.
+  if (time <= snapshots.front().timestamp) return snapshots.front().state;
+
+  for (size_t i = 1; i < snapshots.size(); i++) {
+    const Snapshot &from = snapshots[i - 1], &to = snapshots[i];
+    if (time <= to.timestamp) {
+      return interpolate(
+          from.state, to.state,
+          float((time - from.timestamp) / (to.timestamp - from.timestamp)));
+    }
+  }
+
+  // Past the last one, the body keeps its momentum only for so long.
+  const Snapshot &last = snapshots.back();
+  return extrapolate(
+      last.state,
+      TimeDiff(std::min(time - last.timestamp, Time(extrapolationLimit))));
+}
+
+}
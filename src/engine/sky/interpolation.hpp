@@ -0,0 +1,75 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Buffering remote bodies' states, to render them smoothly between deltas.
+ */
+#pragma once
+#include <deque>
+#include <map>
+#include "engine/sky/physics/physics.hpp"
+#include "util/clocksync.hpp"
+
+namespace sky {
+
+/**
+ * Linear interpolation between two PhysicalStates, turning the short way.
+ */
+PhysicalState interpolate(const PhysicalState &from,
+                          const PhysicalState &to,
+                          const float t);
+
+/**
+ * Client side. The last few timestamped PhysicalStates the server sent for
+ * each remote body, sampled some delay behind the server's clock: between two
+ * snapshots we interpolate, past the latest one we extrapolate for a while
+ * and then hold still.
+ *
+ * The server's clock is estimated from the least delayed records, so a late
+ * delta doesn't move it, and sampled times never go backwards.
+ */
+class InterpolationBuffer {
+ private:
+  struct Snapshot {
+    Time timestamp;
+    PhysicalState state;
+  };
+
+  const size_t depth;
+  std::map<PID, std::deque<Snapshot>> bodies;
+  ClockSync sync; // server time against localtime, over the records
+  optional<Time> lastTimestamp; // of the last record, to count each delta once
+  mutable optional<Time> playhead; // the latest server time sampled
+
+ public:
+  InterpolationBuffer(const size_t depth = 8,
+                      const TimeDiff extrapolationLimit = 0.1);
+
+  const TimeDiff extrapolationLimit;
+
+  void record(const Time localtime, const Time timestamp,
+              const PID pid, const PhysicalState &state);
+  void forget(const PID pid);
+  void clear();
+
+  // The state a body had `delay` before the server time matching `localtime`.
+  optional<PhysicalState> sample(const PID pid, const Time localtime,
+                                 const TimeDiff delay) const;
+
+};
+
+}
@@ -41,12 +41,25 @@ ParticipationInit::ParticipationInit(
     const PlaneControls &controls) :
     controls(controls) { }
 
+/**
+ * InputAck.
+ */
+
+InputAck::InputAck(const InputSequence sequence, const TimeDiff age) :
+    sequence(sequence), age(age) { }
+
 /**
  * ParticipationDelta.
  */
 
 bool ParticipationDelta::verifyStructure() const {
-  return imply(bool(spawn), !bool(state));
+  return imply(bool(spawn), !bool(state) and !bool(compactState))
+      and imply(kill, !spawn and !state and !compactState and !serverState)
+      and !(state and compactState);
+}
+
+bool ParticipationDelta::carriesEvents() const {
+  return spawn or kill or controls or serverState;
 }
 
 ParticipationDelta ParticipationDelta::respectClientAuthority() const {
@@ -55,25 +68,78 @@ ParticipationDelta ParticipationDelta::respectClientAuthority() const {
     delta.serverState = state;
     delta.state.reset();
   }
+  if (compactState) {
+    delta.serverState = compactState->decodeServer();
+    delta.compactState.reset();
+  }
   delta.controls.reset();
   return delta;
 }
 
+void ParticipationDelta::compact(const PlaneStateEncoding &encoding,
+                                 const sf::Vector2f &mapDimensions) {
+  if (state) {
+    compactState.emplace(state.get(), encoding, mapDimensions);
+    state.reset();
+  }
+}
+
+/**
+ * SequencedInput.
+ */
+
+SequencedInput::SequencedInput(const InputSequence sequence,
+                               const Time timestamp,
+                               const ParticipationInput &input) :
+    sequence(sequence), timestamp(timestamp), input(input) { }
+
 /**
  * Participation.
  */
 
+// How many ticks of predictions we remember, and how many unacknowledged
+// inputs.
+static const size_t predictionHistory = 256;
+
 void Participation::effectSpawn(const PlaneTuning &tuning,
                                 const PlaneState &state) {
   plane.emplace(player, physics, controls, tuning, state);
+  predictions.clear();
   caller.doSpawn(player);
 }
 
 void Participation::effectKill() {
   plane.reset();
+  predictions.clear();
   caller.doKill(player);
 }
 
+void Participation::reconcile(const PlaneStateServer &server,
+                              const optional<InputAck> &ack) {
+  // Without a prediction to compare the server's state with, we take it as
+  // it is.
+  const PlaneStateServer current(plane->state);
+  PlaneStateServer predicted{current};
+
+  // The server's state is from `age` after it applied the input; find what
+  // we predicted for that moment.
+  const auto sent = ack ? sentInputs.find(ack->sequence) : sentInputs.end();
+  if (sent != sentInputs.end()) {
+    const Time moment = sent->second + ack->age;
+    sentInputs.erase(sentInputs.begin(), sent);
+    while (predictions.size() > 1 and predictions[1].first <= moment)
+      predictions.pop_front();
+    if (!predictions.empty() and predictions.front().first <= moment)
+      predicted = predictions.front().second;
+  }
+
+  // Whatever we've predicted since then is replayed on top of the server's
+  // state, instead of being snapped back; the history moves along with it.
+  plane->state.applyServer(current.rebased(predicted, server));
+  for (auto &prediction : predictions)
+    prediction.second = prediction.second.rebased(predicted, server);
+}
+
 void Participation::prePhysics() {
   if (role.server()) {
     if (controls.getState<Action::Suicide>()) suicide();
@@ -83,6 +149,16 @@ void Participation::prePhysics() {
 
 void Participation::postPhysics(const float delta) {
   if (plane) plane->postPhysics(delta);
+
+  if (role.server()) {
+    if (lastInput) lastInput->age += delta;
+  } else if (role.client(player.pid)) {
+    predictionClock += delta;
+    if (plane) {
+      predictions.emplace_back(predictionClock, PlaneStateServer(plane->state));
+      if (predictions.size() > predictionHistory) predictions.pop_front();
+    }
+  }
 }
 
 Participation::Participation(Player &player,
@@ -98,6 +174,7 @@ Participation::Participation(Player &player,
     newlyAlive(false),
     newlyDead(false),
     lastControls(initializer.controls),
+    predictionClock(0),
     player(player) {
   if (initializer.spawn)
     effectSpawn(initializer.spawn->first, initializer.spawn->second);
@@ -106,20 +183,32 @@ Participation::Participation(Player &player,
 void Participation::applyDelta(const ParticipationDelta &delta) {
   assert(role.client());
 
+  // Deltas are shared between all clients, so when we have authority over
+  // this participation we have to pick out the server's subset ourselves.
+  const bool authority = role.client(player.pid);
+
   // Apply plane spawn / state.
   if (delta.spawn) {
     effectSpawn(delta.spawn->first, delta.spawn->second);
   } else {
     if (plane) {
-      if (delta.state) plane->state = delta.state.get();
-      else if (delta.serverState)
-        plane->state.applyServer(delta.serverState.get());
-      else effectKill();
+      if (delta.kill) effectKill();
+      else if (delta.state) {
+        if (authority) reconcile(PlaneStateServer(*delta.state), delta.inputAck);
+        else plane->state = delta.state.get();
+      } else if (delta.compactState) {
+        // Relative states have to be rebuilt against their baseline first.
+        if (delta.compactState->isComplete()) {
+          if (authority) reconcile(delta.compactState->decodeServer(), delta.inputAck);
+          else plane->state = delta.compactState->decode(physics.dims);
+        }
+      } else if (delta.serverState)
+        reconcile(delta.serverState.get(), delta.inputAck);
     }
   }
 
   // Modify controls.
-  if (delta.controls) {
+  if (delta.controls and !authority) {
     controls = *delta.controls;
   }
 }
@@ -146,10 +235,12 @@ optional<ParticipationDelta> Participation::collectDelta() {
       newlyAlive = false;
     } else {
       delta.state.emplace(plane->state);
+      delta.inputAck = lastInput;
     }
     useful = true;
   } else {
     if (newlyDead) {
+      delta.kill = true;
       useful = true;
       newlyDead = false;
     }
@@ -208,6 +299,11 @@ void Participation::applyInput(const ParticipationInput &input) {
   }
 }
 
+void Participation::applyInput(const SequencedInput &input) {
+  applyInput(input.input);
+  lastInput.emplace(input.sequence, 0);
+}
+
 optional<ParticipationInput> Participation::collectInput() {
   assert(role.client(player.pid));
 
@@ -226,5 +322,16 @@ optional<ParticipationInput> Participation::collectInput() {
   else return {};
 }
 
+bool Participation::controlsChanged() const {
+  return controls != lastControls;
+}
+
+void Participation::predictInput(const InputSequence sequence) {
+  assert(role.client(player.pid));
+  sentInputs[sequence] = predictionClock;
+  if (sentInputs.size() > predictionHistory)
+    sentInputs.erase(sentInputs.begin());
+}
+
 }
 
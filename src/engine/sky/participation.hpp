@@ -21,6 +21,8 @@
 #pragma once
 #include <Box2D/Box2D.h>
 #include <forward_list>
+#include <deque>
+#include <map>
 #include "util/types.hpp"
 #include "engine/sky/components/entity.hpp"
 #include "engine/sky/physics/physics.hpp"
@@ -50,6 +52,28 @@ struct ParticipationInit {
 
 };
 
+/**
+ * Sequence number of an input in the stream a client sends.
+ */
+using InputSequence = unsigned int;
+
+/**
+ * The last input a server applied to a participation, and how long ago it
+ * did, for the client in authority to reconcile its prediction against.
+ */
+struct InputAck {
+  InputAck() = default;
+  InputAck(const InputSequence sequence, const TimeDiff age);
+
+  template<typename Archive>
+  void serialize(Archive &ar) {
+    ar(sequence, age);
+  }
+
+  InputSequence sequence;
+  TimeDiff age;
+};
+
 /**
  * Delta for Participation's Networked impl.
  */
@@ -58,17 +82,25 @@ struct ParticipationDelta: public VerifyStructure {
 
   template<typename Archive>
   void serialize(Archive &ar) {
-    ar(spawn, state, serverState, controls);
+    ar(spawn, kill, state, compactState, serverState, controls, inputAck);
   }
 
   bool verifyStructure() const;
 
   optional<std::pair<PlaneTuning, PlaneState>> spawn;
+  bool kill{false};
   optional<PlaneState> state; // if client doesn't have authority
+  optional<CompactPlaneState> compactState; // quantized alternative to `state`
   optional<PlaneStateServer> serverState; // if client has authority
   optional<PlaneControls> controls; // client authority
+  optional<InputAck> inputAck; // goes with the state
+
+  // Anything but a plain state update: spawns, kills, control changes.
+  bool carriesEvents() const;
 
   ParticipationDelta respectClientAuthority() const;
+  void compact(const PlaneStateEncoding &encoding,
+               const sf::Vector2f &mapDimensions);
 
 };
 
@@ -89,6 +121,25 @@ struct ParticipationInput {
 
 };
 
+/**
+ * A ParticipationInput, numbered in the order the client produced it, with
+ * the time it produced it at.
+ */
+struct SequencedInput {
+  SequencedInput() = default;
+  SequencedInput(const InputSequence sequence, const Time timestamp,
+                 const ParticipationInput &input);
+
+  template<typename Archive>
+  void serialize(Archive &ar) {
+    ar(sequence, timestamp, input);
+  }
+
+  InputSequence sequence;
+  Time timestamp;
+  ParticipationInput input;
+};
+
 /**
  * A Player's participation in an active game.
  */
@@ -107,11 +158,20 @@ class Participation: public AutoNetworked<ParticipationInit, ParticipationDelta>
   // Delta collection state.
   bool newlyAlive, newlyDead;
   PlaneControls lastControls;
+  optional<InputAck> lastInput;
+
+  // Prediction state, for the client in authority: the server's subset of
+  // our plane's state as we predicted it, and when we sent each input.
+  Time predictionClock;
+  std::deque<std::pair<Time, PlaneStateServer>> predictions;
+  std::map<InputSequence, Time> sentInputs;
 
   // Helpers.
   void effectSpawn(const PlaneTuning &tuning,
                    const PlaneState &state);
   void effectKill();
+  void reconcile(const PlaneStateServer &server,
+                 const optional<InputAck> &ack);
 
   // Sky API.
   void prePhysics();
@@ -148,7 +208,10 @@ class Participation: public AutoNetworked<ParticipationInit, ParticipationDelta>
 
   // ParticipationInput.
   void applyInput(const ParticipationInput &input);
+  void applyInput(const SequencedInput &input); // acknowledged in deltas
   optional<ParticipationInput> collectInput();
+  bool controlsChanged() const; // since the last collectInput()
+  void predictInput(const InputSequence sequence); // once it's sent
 
 };
 
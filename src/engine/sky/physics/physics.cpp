@@ -298,4 +298,13 @@ void PhysicalState::readFromBody(const Physics &physics,
   rotvel = toDeg(body->GetAngularVelocity());
 }
 
+bool operator==(const PhysicalState &x, const PhysicalState &y) {
+  return x.pos == y.pos and x.vel == y.vel
+      and float(x.rot) == float(y.rot) and x.rotvel == y.rotvel;
+}
+
+bool operator!=(const PhysicalState &x, const PhysicalState &y) {
+  return !(x == y);
+}
+
 }
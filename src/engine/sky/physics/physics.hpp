@@ -170,4 +170,7 @@ struct PhysicalState {
   void readFromBody(const Physics &physics, const b2Body *const body);
 };
 
+bool operator==(const PhysicalState &x, const PhysicalState &y);
+bool operator!=(const PhysicalState &x, const PhysicalState &y);
+
 }
@@ -117,6 +117,17 @@ PlaneStateServer::PlaneStateServer(const PlaneState &state) :
     health(state.health),
     primaryCooldown(state.primaryCooldown) { }
 
+PlaneStateServer PlaneStateServer::rebased(const PlaneStateServer &from,
+                                           const PlaneStateServer &to) const {
+  PlaneStateServer state{*this};
+  state.energy += float(to.energy) - float(from.energy);
+  state.health += float(to.health) - float(from.health);
+  state.primaryCooldown = Cooldown(clamp(
+      0.0f, 1.0f, float(primaryCooldown)
+          + float(to.primaryCooldown) - float(from.primaryCooldown)));
+  return state;
+}
+
 /**
  * PlaneState.
  */
@@ -167,6 +178,208 @@ void PlaneState::applyServer(const PlaneStateServer &server) {
   primaryCooldown = server.primaryCooldown;
 }
 
+/**
+ * PlaneStateEncoding.
+ */
+
+uint16_t PlaneStateEncoding::pack() const {
+  return uint16_t(uint16_t(position)
+                      | (uint16_t(velocity) << 2)
+                      | (uint16_t(rotation) << 4)
+                      | (uint16_t(rotvel) << 6)
+                      | (uint16_t(scalars) << 8));
+}
+
+PlaneStateEncoding PlaneStateEncoding::unpack(const uint16_t bits) {
+  PlaneStateEncoding encoding;
+  encoding.position = unpackPrecision(bits);
+  encoding.velocity = unpackPrecision(bits >> 2);
+  encoding.rotation = unpackPrecision(bits >> 4);
+  encoding.rotvel = unpackPrecision(bits >> 6);
+  encoding.scalars = unpackPrecision(bits >> 8);
+  return encoding;
+}
+
+Precision PlaneStateEncoding::unpackPrecision(const uint16_t bits) {
+  switch (bits & 3) {
+    case 0:
+      return Precision::Full;
+    case 1:
+      return Precision::Fixed16;
+    default:
+      return Precision::Fixed8;
+  }
+}
+
+PlaneStateEncoding::PlaneStateEncoding() :
+    position(Precision::Fixed16),
+    velocity(Precision::Fixed16),
+    rotation(Precision::Fixed16),
+    // 8 bits over the rotvel range are 4 degrees/s apiece, which shows in turns.
+    rotvel(Precision::Fixed16),
+    scalars(Precision::Fixed8) { }
+
+PlaneStateEncoding PlaneStateEncoding::Lossless() {
+  PlaneStateEncoding encoding;
+  encoding.position = Precision::Full;
+  encoding.velocity = Precision::Full;
+  encoding.rotation = Precision::Full;
+  encoding.rotvel = Precision::Full;
+  encoding.scalars = Precision::Full;
+  return encoding;
+}
+
+Precision PlaneStateEncoding::precisionOf(const PlaneField field) const {
+  switch (field) {
+    case PlaneField::PosX:
+    case PlaneField::PosY:
+      return position;
+    case PlaneField::VelX:
+    case PlaneField::VelY:
+    case PlaneField::LeftoverVelX:
+    case PlaneField::LeftoverVelY:
+      return velocity;
+    case PlaneField::Rot:
+      return rotation;
+    case PlaneField::Rotvel:
+      return rotvel;
+    default:
+      return scalars;
+  }
+}
+
+Quantizer PlaneStateEncoding::quantizerOf(
+    const PlaneField field, const sf::Vector2f &mapDimensions) const {
+  // Generous bounds on the plane's speeds; planes don't get anywhere near them.
+  static constexpr float maxVelocity = 1024, maxRotvel = 512;
+
+  const Precision precision = precisionOf(field);
+  switch (field) {
+    case PlaneField::PosX:
+      return Quantizer(precision, 0, mapDimensions.x);
+    case PlaneField::PosY:
+      return Quantizer(precision, 0, mapDimensions.y);
+    case PlaneField::VelX:
+    case PlaneField::VelY:
+    case PlaneField::LeftoverVelX:
+    case PlaneField::LeftoverVelY:
+      return Quantizer(precision, -maxVelocity, maxVelocity);
+    case PlaneField::Rot:
+      return Quantizer(precision, 0, 360);
+    case PlaneField::Rotvel:
+      return Quantizer(precision, -maxRotvel, maxRotvel);
+    default:
+      return Quantizer(precision, 0, 1);
+  }
+}
+
+bool operator==(const PlaneStateEncoding &x, const PlaneStateEncoding &y) {
+  return x.position == y.position and x.velocity == y.velocity
+      and x.rotation == y.rotation and x.rotvel == y.rotvel
+      and x.scalars == y.scalars;
+}
+
+/**
+ * CompactPlaneState.
+ */
+
+constexpr uint16_t CompactPlaneState::completeMask;
+
+CompactPlaneState::CompactPlaneState() :
+    stalled(false),
+    present(completeMask) { }
+
+CompactPlaneState::CompactPlaneState(const PlaneState &state,
+                                     const PlaneStateEncoding &encoding,
+                                     const sf::Vector2f &mapDimensions) :
+    encoding(encoding),
+    stalled(state.stalled),
+    present(completeMask) {
+  const auto encode = [&](const PlaneField field, const float value) {
+    codes[size_t(field)] =
+        encoding.quantizerOf(field, mapDimensions).encode(value);
+  };
+
+  encode(PlaneField::PosX, state.physical.pos.x);
+  encode(PlaneField::PosY, state.physical.pos.y);
+  encode(PlaneField::VelX, state.physical.vel.x);
+  encode(PlaneField::VelY, state.physical.vel.y);
+  encode(PlaneField::Rot, state.physical.rot);
+  encode(PlaneField::Rotvel, state.physical.rotvel);
+  encode(PlaneField::LeftoverVelX, state.leftoverVel.x);
+  encode(PlaneField::LeftoverVelY, state.leftoverVel.y);
+  encode(PlaneField::Airspeed, state.airspeed);
+  encode(PlaneField::Afterburner, state.afterburner);
+  encode(PlaneField::Throttle, state.throttle);
+  encode(PlaneField::Energy, state.energy);
+  encode(PlaneField::Health, state.health);
+  encode(PlaneField::PrimaryCooldown, state.primaryCooldown);
+}
+
+bool CompactPlaneState::isComplete() const {
+  return present == completeMask;
+}
+
+CompactPlaneState CompactPlaneState::relativeTo(
+    const CompactPlaneState &baseline) const {
+  CompactPlaneState relative(*this);
+  if (!isComplete() or !baseline.isComplete()
+      or !(baseline.encoding == encoding))
+    return relative;
+
+  for (size_t i = 0; i < codes.size(); ++i) {
+    if (codes[i] == baseline.codes[i]) relative.present &= ~(1 << i);
+  }
+  return relative;
+}
+
+bool CompactPlaneState::rebase(const CompactPlaneState &baseline) {
+  if (isComplete()) return true;
+  if (!baseline.isComplete() or !(baseline.encoding == encoding)) return false;
+
+  for (size_t i = 0; i < codes.size(); ++i) {
+    if (!(present & (1 << i))) codes[i] = baseline.codes[i];
+  }
+  present = completeMask;
+  return true;
+}
+
+float CompactPlaneState::decodeField(const PlaneField field,
+                                     const sf::Vector2f &mapDimensions) const {
+  return encoding.quantizerOf(field, mapDimensions).decode(codes[size_t(field)]);
+}
+
+PlaneState CompactPlaneState::decode(const sf::Vector2f &mapDimensions) const {
+  const auto decode = [&](const PlaneField field) {
+    return decodeField(field, mapDimensions);
+  };
+
+  PlaneState state;
+  state.physical = PhysicalState(
+      {decode(PlaneField::PosX), decode(PlaneField::PosY)},
+      {decode(PlaneField::VelX), decode(PlaneField::VelY)},
+      decode(PlaneField::Rot), decode(PlaneField::Rotvel));
+  state.stalled = stalled;
+  state.leftoverVel = {decode(PlaneField::LeftoverVelX),
+                       decode(PlaneField::LeftoverVelY)};
+  state.airspeed = decode(PlaneField::Airspeed);
+  state.afterburner = decode(PlaneField::Afterburner);
+  state.throttle = decode(PlaneField::Throttle);
+  state.applyServer(decodeServer());
+  return state;
+}
+
+PlaneStateServer CompactPlaneState::decodeServer() const {
+  // The server's subset doesn't depend on the map dimensions.
+  const sf::Vector2f noDimensions;
+  PlaneStateServer state;
+  state.energy = decodeField(PlaneField::Energy, noDimensions);
+  state.health = decodeField(PlaneField::Health, noDimensions);
+  state.primaryCooldown =
+      Cooldown(decodeField(PlaneField::PrimaryCooldown, noDimensions));
+  return state;
+}
+
 /**
  * PlaneControls.
  */
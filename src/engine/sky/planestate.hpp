@@ -20,6 +20,7 @@
  */
 #pragma once
 #include <bitset>
+#include <array>
 #include "util/types.hpp"
 #include "engine/sky/physics/physics.hpp"
 #include "engine/types.hpp"
@@ -151,6 +152,10 @@ struct PlaneStateServer {
   Clamped energy, health;
   Cooldown primaryCooldown;
 
+  // This state, moved by however much `to` differs from `from`.
+  PlaneStateServer rebased(const PlaneStateServer &from,
+                           const PlaneStateServer &to) const;
+
 };
 
 /**
@@ -187,6 +192,110 @@ struct PlaneState {
 
 };
 
+/**
+ * The fields of a PlaneState, as they're quantized in a CompactPlaneState.
+ */
+enum class PlaneField {
+  PosX, PosY, VelX, VelY, Rot, Rotvel,
+  LeftoverVelX, LeftoverVelY,
+  Airspeed, Afterburner, Throttle, Energy, Health, PrimaryCooldown,
+  MAX
+};
+
+/**
+ * The Precision that each group of fields in a CompactPlaneState is
+ * transmitted with.
+ */
+struct PlaneStateEncoding {
+  PlaneStateEncoding(); // constructs with sensible compact defaults
+  static PlaneStateEncoding Lossless();
+
+  // Packing into the low ten bits of a CompactPlaneState's header.
+  uint16_t pack() const;
+  static PlaneStateEncoding unpack(const uint16_t bits);
+
+  Precision position, // bounded by the map dimensions
+      velocity, // also used for leftoverVel
+      rotation,
+      rotvel,
+      scalars; // Clamped values and the primary cooldown
+
+  Precision precisionOf(const PlaneField field) const;
+  Quantizer quantizerOf(const PlaneField field,
+                        const sf::Vector2f &mapDimensions) const;
+
+ private:
+  static Precision unpackPrecision(const uint16_t bits);
+
+};
+
+bool operator==(const PlaneStateEncoding &x, const PlaneStateEncoding &y);
+
+/**
+ * PlaneState, quantized according to a PlaneStateEncoding. Positions are
+ * bounded by the dimensions of the map, so the encoder and decoder have to
+ * agree on them.
+ *
+ * A CompactPlaneState can also be relative to a baseline that the receiving
+ * end already has, in which case it only carries the fields that changed.
+ */
+struct CompactPlaneState {
+ private:
+  static constexpr uint16_t stalledBit = 1 << 10, relativeBit = 1 << 15;
+
+ public:
+  static constexpr uint16_t completeMask = (1 << size_t(PlaneField::MAX)) - 1;
+
+  CompactPlaneState(); // for packing
+  CompactPlaneState(const PlaneState &state,
+                    const PlaneStateEncoding &encoding,
+                    const sf::Vector2f &mapDimensions);
+
+  template<typename Archive>
+  void save(Archive &ar) const {
+    const bool relative = !isComplete();
+    ar(uint16_t(encoding.pack()
+                    | (stalled ? stalledBit : 0)
+                    | (relative ? relativeBit : 0)));
+    if (relative) ar(present);
+    for (size_t i = 0; i < codes.size(); ++i) {
+      if (present & (1 << i))
+        saveQuantized(ar, encoding.precisionOf(PlaneField(i)), codes[i]);
+    }
+  }
+
+  template<typename Archive>
+  void load(Archive &ar) {
+    uint16_t header;
+    ar(header);
+    encoding = PlaneStateEncoding::unpack(header);
+    stalled = bool(header & stalledBit);
+    present = completeMask;
+    if (header & relativeBit) ar(present);
+    for (size_t i = 0; i < codes.size(); ++i) {
+      if (present & (1 << i))
+        codes[i] = loadQuantized(ar, encoding.precisionOf(PlaneField(i)));
+    }
+  }
+
+  PlaneStateEncoding encoding;
+  bool stalled;
+  uint16_t present; // mask of the fields we carry codes for
+  std::array<uint32_t, size_t(PlaneField::MAX)> codes;
+
+  // Baselines.
+  bool isComplete() const;
+  CompactPlaneState relativeTo(const CompactPlaneState &baseline) const;
+  bool rebase(const CompactPlaneState &baseline);
+
+  // Decoding, only valid when complete.
+  float decodeField(const PlaneField field,
+                    const sf::Vector2f &mapDimensions) const;
+  PlaneState decode(const sf::Vector2f &mapDimensions) const;
+  PlaneStateServer decodeServer() const;
+
+};
+
 /**
  * The persistent control state of a Participation; synchronized along with the
  * rest of the Participation's state.
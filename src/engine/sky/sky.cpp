@@ -56,6 +56,63 @@ SkyDelta SkyDelta::respectAuthority(const Player &player) const {
   return newDelta;
 }
 
+bool SkyDelta::carriesEvents() const {
+  if (settings) return true;
+  for (const auto &participation : participations)
+    if (participation.second.carriesEvents()) return true;
+  return (entities and sky::carriesEvents<Entity>(entities.get()))
+      or (explosions and sky::carriesEvents<Explosion>(explosions.get()))
+      or (homeBases and sky::carriesEvents<HomeBase>(homeBases.get()))
+      or (zones and sky::carriesEvents<Zone>(zones.get()));
+}
+
+void SkyDelta::dropState(const std::set<PID> &covered) {
+  auto iter = participations.begin();
+  while (iter != participations.end()) {
+    // Newer states were applied already; control changes still hold.
+    auto &participation = iter->second;
+    participation.state.reset();
+    participation.compactState.reset();
+    participation.serverState.reset();
+    participation.inputAck.reset();
+    if (covered.count(iter->first)) {
+      participation.spawn.reset();
+      participation.kill = false;
+    }
+
+    if (participation.carriesEvents()) ++iter;
+    else iter = participations.erase(iter);
+  }
+
+  if (entities) sky::dropState<Entity>(entities.get());
+  if (explosions) sky::dropState<Explosion>(explosions.get());
+  if (homeBases) sky::dropState<HomeBase>(homeBases.get());
+  if (zones) sky::dropState<Zone>(zones.get());
+}
+
+namespace {
+
+template<typename Data>
+void absorbSet(optional<ComponentSetDelta<Data>> &delta,
+               const optional<ComponentSetDelta<Data>> &later) {
+  if (!later) return;
+  if (delta) sky::absorb<Data>(delta.get(), later.get());
+  else delta = later;
+}
+
+}
+
+void SkyDelta::absorb(const SkyDelta &later) {
+  // Every plane's state is in every delta, so the later ones supersede.
+  if (later.settings) settings = later.settings;
+  participations = later.participations;
+
+  absorbSet<Entity>(entities, later.entities);
+  absorbSet<Explosion>(explosions, later.explosions);
+  absorbSet<HomeBase>(homeBases, later.homeBases);
+  absorbSet<Zone>(zones, later.zones);
+}
+
 /**
  * Sky.
  */
@@ -219,10 +276,11 @@ optional<SkyDelta> Sky::collectDelta() {
   bool useful{false};
 
   for (auto &participation : participations) {
-    const auto pDelta = participation.second.collectDelta();
+    auto pDelta = participation.second.collectDelta();
     if (pDelta) {
+      if (stateEncoding) pDelta->compact(*stateEncoding, physics.dims);
       delta.participations.emplace(
-          participation.first, *pDelta);
+          participation.first, std::move(*pDelta));
       useful = true;
     }
   }
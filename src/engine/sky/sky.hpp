@@ -19,6 +19,7 @@
  * Physical game state of an Arena. Attaches to a Map.
  */
 #pragma once
+#include <set>
 #include "engine/sky/physics/physics.hpp"
 #include "participation.hpp"
 #include "skysettings.hpp"
@@ -66,9 +67,18 @@ struct SkyDelta: public VerifyStructure {
 
   COMPONENT_DELTAS
 
-  // Transform to respect client authority.
+  // Transform to respect client authority. Participation::applyDelta
+  // does the same on the client, so this isn't needed to transmit deltas.
   SkyDelta respectAuthority(const Player &player) const;
 
+  // Whether this has to arrive, or can be superseded by the next delta.
+  bool carriesEvents() const;
+  // Strip plain state updates, for deltas that arrived out of order, and
+  // the spawns and kills of planes a newer delta already covered.
+  void dropState(const std::set<PID> &covered = {});
+  // Fold in the next delta, for clients that weren't sent this one.
+  void absorb(const SkyDelta &later);
+
 };
 
 /**
@@ -126,6 +136,9 @@ class Sky: public PhysicsListener,
   // Settings.
   SkySettings settings;
 
+  // Quantization of plane states in collected deltas, if any (server-side).
+  optional<PlaneStateEncoding> stateEncoding;
+
   // AutoNetworked impl.
   void applyDelta(const SkyDelta &delta) override final;
   SkyInit captureInitializer() const override final;
@@ -0,0 +1,85 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "snapshothistory.hpp"
+
+namespace sky {
+
+/**
+ * SnapshotHistory.
+ */
+
+SnapshotHistory::SnapshotHistory(const size_t depth) :
+    depth(depth) { }
+
+void SnapshotHistory::record(const SkySequence sequence,
+                             const SkyDelta &delta) {
+  auto snapshot = std::make_shared<SkySnapshot>();
+  for (const auto &participation : delta.participations) {
+    const auto &compactState = participation.second.compactState;
+    if (compactState and compactState->isComplete())
+      snapshot->planes.emplace(participation.first, compactState.get());
+  }
+  snapshots[sequence] = std::move(snapshot);
+
+  while (snapshots.size() > depth) snapshots.erase(snapshots.begin());
+}
+
+const SkySnapshot *SnapshotHistory::find(const SkySequence sequence) const {
+  const auto snapshot = snapshots.find(sequence);
+  if (snapshot != snapshots.end()) return snapshot->second.get();
+  return nullptr;
+}
+
+std::shared_ptr<const SkySnapshot> SnapshotHistory::share(
+    const SkySequence sequence) const {
+  const auto snapshot = snapshots.find(sequence);
+  if (snapshot != snapshots.end()) return snapshot->second;
+  return nullptr;
+}
+
+void SnapshotHistory::clear() {
+  snapshots.clear();
+}
+
+SkyDelta SnapshotHistory::relativeTo(const SkyDelta &delta,
+                                     const SkySnapshot &baseline) {
+  SkyDelta relative{delta};
+  for (auto &participation : relative.participations) {
+    auto &compactState = participation.second.compactState;
+    if (!compactState) continue;
+
+    const auto plane = baseline.planes.find(participation.first);
+    if (plane != baseline.planes.end())
+      compactState = compactState->relativeTo(plane->second);
+  }
+  return relative;
+}
+
+bool SnapshotHistory::rebuild(SkyDelta &delta, const SkySnapshot &baseline) {
+  for (auto &participation : delta.participations) {
+    auto &compactState = participation.second.compactState;
+    if (!compactState or compactState->isComplete()) continue;
+
+    const auto plane = baseline.planes.find(participation.first);
+    if (plane == baseline.planes.end()) return false;
+    if (!compactState->rebase(plane->second)) return false;
+  }
+  return true;
+}
+
+}
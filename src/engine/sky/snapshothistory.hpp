@@ -0,0 +1,67 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * History of the plane states sent in SkyDeltas, used as baselines for delta compression.
+ */
+#pragma once
+#include <memory>
+#include "sky.hpp"
+
+namespace sky {
+
+/**
+ * Sequence number identifying a SkyDelta in the stream the server sends.
+ */
+using SkySequence = unsigned int;
+
+/**
+ * The complete compact plane states carried by one SkyDelta.
+ */
+struct SkySnapshot {
+  std::map<PID, CompactPlaneState> planes;
+};
+
+/**
+ * Bounded history of SkySnapshots, indexed by sequence. Both ends keep one:
+ * the server encodes deltas relative to a snapshot a client acknowledged, the
+ * client rebuilds them from its copy of that same snapshot.
+ */
+class SnapshotHistory {
+ private:
+  const size_t depth;
+  std::map<SkySequence, std::shared_ptr<const SkySnapshot>> snapshots;
+
+ public:
+  SnapshotHistory() = delete;
+  SnapshotHistory(const size_t depth);
+
+  void record(const SkySequence sequence, const SkyDelta &delta);
+  const SkySnapshot *find(const SkySequence sequence) const;
+  // For holding on to a snapshot after it leaves the history.
+  std::shared_ptr<const SkySnapshot> share(const SkySequence sequence) const;
+  void clear();
+
+  // Only carry the fields of plane states that changed since the baseline.
+  static SkyDelta relativeTo(const SkyDelta &delta,
+                             const SkySnapshot &baseline);
+  // Fill in a relative delta from its baseline, returning false on failure.
+  static bool rebuild(SkyDelta &delta, const SkySnapshot &baseline);
+
+};
+
+}
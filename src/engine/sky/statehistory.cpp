@@ -0,0 +1,104 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include "statehistory.hpp"
+#include "interpolation.hpp"
+#include "util/methods.hpp"
+
+namespace sky {
+
+/**
+ * PhysicalHistory.
+ */
+
+const PhysicalHistory::Snapshot &PhysicalHistory::at(const size_t age) const {
+  return snapshots[(next + depth - size + age) % depth];
+}
+
+PhysicalHistory::PhysicalHistory(const size_t depth) :
+    snapshots(depth),
+    next(0),
+    size(0),
+    depth(depth) { }
+
+void PhysicalHistory::record(const Time timestamp,
+                             const PhysicalState &state) {
+  snapshots[next] = {timestamp, state};
+  next = (next + 1) % depth;
+  size = std::min(size + 1, depth);
+}
+
+void PhysicalHistory::clear() {
+  next = 0;
+  size = 0;
+}
+
+optional<PhysicalState> PhysicalHistory::rewind(const Time time) const {
+  if (size == 0) return {};
+  if (time <= at(0).timestamp) return at(0).state;
+
+  for (size_t age = 1; age < size; age++) {
+    const Snapshot &from = at(age - 1), &to = at(age);
+    if (time <= to.timestamp) {
+      return interpolate(
+          from.state, to.state,
+          float((time - from.timestamp) / (to.timestamp - from.timestamp)));
+    }
+  }
+
+  return at(size - 1).state;
+}
+
+/**
+ * Hitscan.
+ */
+
+optional<float> hitscan(const sf::Vector2f &origin, const Angle direction,
+                        const float range, const PhysicalState &target,
+                        const sf::Vector2f &hitbox) {
+  // Into the frame of the hitbox, where it's an axis-aligned rectangle.
+  const float rot = toRad(target.rot);
+  const sf::Vector2f offset = origin - target.pos;
+  const sf::Vector2f localOrigin(
+      offset.x * std::cos(rot) + offset.y * std::sin(rot),
+      -offset.x * std::sin(rot) + offset.y * std::cos(rot));
+  const float localAngle = toRad(direction) - rot;
+  const sf::Vector2f localDirection(std::cos(localAngle), std::sin(localAngle));
+
+  // Clipping the ray against both pairs of sides.
+  float enter = 0, exit = range;
+  const float origins[2]{localOrigin.x, localOrigin.y},
+      directions[2]{localDirection.x, localDirection.y},
+      halves[2]{hitbox.x / 2, hitbox.y / 2};
+  for (size_t axis = 0; axis < 2; axis++) {
+    if (std::abs(directions[axis]) < 1e-6f) {
+      if (std::abs(origins[axis]) > halves[axis]) return {};
+      continue;
+    }
+    float first = (-halves[axis] - origins[axis]) / directions[axis],
+        second = (halves[axis] - origins[axis]) / directions[axis];
+    if (first > second) std::swap(first, second);
+    enter = std::max(enter, first);
+    exit = std::min(exit, second);
+    if (enter > exit) return {};
+  }
+
+  return enter;
+}
+
+}
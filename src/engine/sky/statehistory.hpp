@@ -0,0 +1,63 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Bounded histories of bodies' states, for rewinding the sky on the server.
+ */
+#pragma once
+#include <vector>
+#include "engine/sky/physics/physics.hpp"
+
+namespace sky {
+
+/**
+ * The latest few timestamped PhysicalStates of a body, in a ring buffer of
+ * fixed depth. Rewinding interpolates between them, and never goes further
+ * back than the oldest one.
+ */
+class PhysicalHistory {
+ private:
+  struct Snapshot {
+    Time timestamp;
+    PhysicalState state;
+  };
+
+  std::vector<Snapshot> snapshots;
+  size_t next, size; // where the next snapshot goes, how many there are
+
+  const Snapshot &at(const size_t age) const; // 0 is the oldest
+
+ public:
+  PhysicalHistory(const size_t depth = 32);
+
+  const size_t depth;
+
+  void record(const Time timestamp, const PhysicalState &state);
+  void clear();
+
+  optional<PhysicalState> rewind(const Time time) const;
+
+};
+
+/**
+ * How far along a ray it meets a plane's hitbox, if it does within range.
+ */
+optional<float> hitscan(const sf::Vector2f &origin, const Angle direction,
+                        const float range, const PhysicalState &target,
+                        const sf::Vector2f &hitbox);
+
+}
@@ -0,0 +1,237 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Load generator: many synthetic clients against one server.
+ *
+ * usage: solemnsky_loadgen [clients] [hostname] [port] [seconds]
+ *                           [--start] [--loopback] [--arenas N]
+ *
+ * The first client authenticates over rcon and polls the server's loop
+ * timing, which is logged as it comes in. With --start, it also starts a
+ * game.
+ *
+ * With --loopback, a vanilla server runs in this process, and everyone
+ * talks over a tg::LoopbackNetwork on a virtual clock, as fast as the CPU
+ * allows. This benchmarks the protocol stack without the kernel in the way.
+ *
+ * With --arenas N, clients are dealt out between arenas 0 to N - 1, which
+ * the in-process server creates for loopback runs.
+ */
+#include <chrono>
+#include <thread>
+#include "syntheticclient.hpp"
+#include "util/loopback.hpp"
+#include "server/servers/vanilla.hpp"
+
+namespace {
+
+struct Options {
+  size_t clients = 100;
+  std::string hostname = "localhost";
+  Port port = 4242;
+  TimeDiff duration = 60;
+  bool start = false;
+  bool loopback = false;
+  size_t arenas = 1;
+};
+
+Options parseOptions(const int argc, char **argv) {
+  Options options;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "--start") options.start = true;
+    else if (arg == "--loopback") options.loopback = true;
+    else if (arg == "--arenas" and i + 1 < argc)
+      options.arenas = std::max<size_t>(1, std::stoul(argv[++i]));
+    else positional.push_back(arg);
+  }
+
+  if (positional.size() > 0) options.clients = std::stoul(positional[0]);
+  if (positional.size() > 1) options.hostname = positional[1];
+  if (positional.size() > 2) options.port = Port(std::stoul(positional[2]));
+  if (positional.size() > 3) options.duration = std::stof(positional[3]);
+  return options;
+}
+
+/**
+ * What the synthetic clients saw since the last report.
+ */
+void report(std::vector<std::unique_ptr<SyntheticClient>> &clients,
+            std::vector<std::pair<size_t, size_t>> &lastBytes,
+            const TimeDiff window) {
+  size_t playing{0}, connected{0}, deltas{0};
+  Kbps meanDown{0}, maxDown{0}, meanUp{0}, maxUp{0};
+  TimeDiff meanDelay{0}, maxDelay{0};
+
+  for (size_t i = 0; i < clients.size(); i++) {
+    auto &client = *clients[i];
+    const auto stats = client.linkStats();
+    if (!stats) continue;
+    connected++;
+
+    const Kbps down = (stats->bytesReceived - lastBytes[i].first)
+        / 1000.0f / window;
+    const Kbps up = (stats->bytesSent - lastBytes[i].second)
+        / 1000.0f / window;
+    lastBytes[i] = {stats->bytesReceived, stats->bytesSent};
+    meanDown += down;
+    meanUp += up;
+    maxDown = std::max(maxDown, down);
+    maxUp = std::max(maxUp, up);
+
+    if (client.getState() == SyntheticState::Playing) {
+      playing++;
+      const TimeStats delay(client.deltaDelay);
+      meanDelay += delay.mean;
+      maxDelay = std::max(maxDelay, delay.max);
+    }
+    deltas += client.deltasReceived;
+    client.deltasReceived = 0;
+  }
+
+  if (connected > 0) {
+    meanDown /= connected;
+    meanUp /= connected;
+  }
+  if (playing > 0) meanDelay /= playing;
+
+  appLog(std::to_string(connected) + " connected, "
+             + std::to_string(playing) + " playing, "
+             + std::to_string(deltas) + " sky deltas received",
+         LogOrigin::Client);
+  appLog("per-client bandwidth (kB/s): down " + printKbps(meanDown)
+             + " avg / " + printKbps(maxDown) + " max, up "
+             + printKbps(meanUp) + " avg / " + printKbps(maxUp) + " max",
+         LogOrigin::Client);
+  appLog("delta delay: " + printTimeDiff(meanDelay) + " avg, "
+             + printTimeDiff(maxDelay) + " max", LogOrigin::Client);
+}
+
+}
+
+int main(int argc, char **argv) {
+  const Options options = parseOptions(argc, argv);
+  tg::UsageFlag flag; // for enet global state
+  tg::Telegraph<sky::ServerPacket> telegraph;
+
+  appLog("Connecting " + std::to_string(options.clients)
+             + " synthetic clients to " + options.hostname + ":"
+             + std::to_string(options.port), LogOrigin::Client);
+
+  using Clock = std::chrono::steady_clock;
+  const TimeDiff tickInterval = 1.0f / 60.0f;
+  const size_t connectsPerTick = 10; // don't flood the server's handshakes
+
+  // In-process server, for loopback runs.
+  std::unique_ptr<tg::LoopbackNetwork> network;
+  std::unique_ptr<ServerExec> server;
+  if (options.loopback) {
+    std::vector<sky::ArenaInit> arenas;
+    for (size_t i = 0; i < options.arenas; i++)
+      arenas.emplace_back("loadgen-" + std::to_string(i), "asteroids");
+
+    network = std::make_unique<tg::LoopbackNetwork>(0.05f);
+    server = std::make_unique<ServerExec>(
+        std::make_unique<tg::LoopbackTransport>(*network, options.port),
+        arenas,
+        [](ServerShared &shared) {
+          return std::make_unique<VanillaServer>(shared);
+        });
+  }
+
+  const auto makeTransport = [&]() -> std::unique_ptr<tg::Transport> {
+    if (network) return std::make_unique<tg::LoopbackTransport>(*network);
+    return std::make_unique<tg::ENetTransport>(tg::HostType::Client, 0);
+  };
+  const auto step = [&]() {
+    if (network) {
+      network->advance(tickInterval);
+      server->step(tickInterval);
+    }
+  };
+
+  std::vector<std::unique_ptr<SyntheticClient>> clients;
+  std::vector<std::pair<size_t, size_t>> lastBytes(options.clients);
+  Scheduler reportSchedule(5);
+  bool authenticated = false;
+  TimeDiff elapsed = 0;
+
+  const auto startTime = Clock::now();
+  auto nextTick = startTime;
+  while (elapsed < options.duration) {
+    for (size_t i = 0;
+         i < connectsPerTick and clients.size() < options.clients; i++) {
+      clients.push_back(std::make_unique<SyntheticClient>(
+          makeTransport(), telegraph,
+          "loadgen-" + std::to_string(clients.size()),
+          options.hostname, options.port, unsigned(clients.size())));
+      clients.back()->arena = sky::ArenaID(
+          (clients.size() - 1) % options.arenas);
+    }
+
+    step();
+    for (auto &client : clients) {
+      client->poll();
+      client->tick(tickInterval);
+    }
+
+    if (!clients.empty()
+        and clients[0]->getState() != SyntheticState::Connecting
+        and clients[0]->getState() != SyntheticState::Joining) {
+      auto &admin = *clients[0];
+      if (!authenticated) {
+        admin.rcon("auth");
+        if (options.start) admin.rcon("start");
+        authenticated = true;
+      }
+    }
+
+    if (reportSchedule.tick(tickInterval)) {
+      report(clients, lastBytes, 5);
+      if (authenticated) clients[0]->rcon("loopstats");
+      reportSchedule.reset();
+    }
+
+    elapsed += tickInterval;
+    if (!network) {
+      nextTick += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<TimeDiff>(tickInterval));
+      std::this_thread::sleep_until(nextTick);
+    }
+  }
+
+  if (network) {
+    const TimeDiff wallTime =
+        std::chrono::duration<TimeDiff>(Clock::now() - startTime).count();
+    appLog("Simulated " + printTimeDiff(elapsed) + " in "
+               + printTimeDiff(wallTime) + " of wall time",
+           LogOrigin::Client);
+  }
+
+  StringPrinter traffic;
+  telegraph.traffic.print(traffic);
+  appLog("Traffic over the run:\n" + traffic.getString(), LogOrigin::Client);
+
+  for (auto &client : clients) client->disconnect();
+  for (size_t i = 0; i < 10; i++) {
+    step();
+    for (auto &client : clients) client->poll();
+    if (!network) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
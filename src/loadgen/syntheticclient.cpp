@@ -0,0 +1,233 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "syntheticclient.hpp"
+
+/**
+ * SyntheticClient.
+ */
+
+void SyntheticClient::observeTimestamp(const Time timestamp) {
+  const Time offset = uptime - timestamp;
+  if (!minOffset or offset < minOffset.get()) minOffset = offset;
+}
+
+void SyntheticClient::transmit(sky::ClientPacket packet) {
+  if (!server) return;
+  packet.skyAck = lastSequence;
+  transmittedAck = lastSequence;
+  telegraph.transmit(host, server, packet);
+}
+
+void SyntheticClient::processPacket(sky::ServerPacket &&packet) {
+  using namespace sky;
+
+  switch (packet.type) {
+    case ServerPacket::Type::Init: {
+      if (state != SyntheticState::Joining) break;
+      state = SyntheticState::Lobby;
+      skyRunning = bool(packet.skyHandleInit.get());
+      break;
+    }
+
+    case ServerPacket::Type::DeltaSkyHandle: {
+      // A game started or stopped, whatever sky we had is gone.
+      if (state == SyntheticState::Joining) break;
+      state = SyntheticState::Lobby;
+      skyRunning = bool(packet.skyHandleDelta.get());
+      lastSequence.reset();
+      break;
+    }
+
+    case ServerPacket::Type::InitSky: {
+      if (state != SyntheticState::LoadingSky) break;
+      state = SyntheticState::Playing;
+      lastSequence.reset();
+      spawnSchedule.prime();
+      break;
+    }
+
+    case ServerPacket::Type::Ping: {
+      observeTimestamp(packet.timestamp.get());
+      transmit(ClientPacket::Pong(packet.timestamp.get(), uptime, 0.1f));
+      break;
+    }
+
+    case ServerPacket::Type::DeltaSky: {
+      if (state != SyntheticState::Playing) break;
+      observeTimestamp(packet.timestamp.get());
+      deltaDelay.push(TimeDiff(uptime - packet.timestamp.get()
+                                   - minOffset.get()));
+      deltasReceived++;
+      lastSequence = packet.skySequence.get();
+      break;
+    }
+
+    case ServerPacket::Type::RCon: {
+      appLog(nickname + " <- " + packet.stringData.get(), LogOrigin::Client);
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+void SyntheticClient::randomizeControls() {
+  using sky::Action;
+  // Flip one of the flight actions; weapons and suicide stay off.
+  static const std::vector<Action> actions{
+      Action::Thrust, Action::Reverse, Action::Left, Action::Right,
+      Action::Primary};
+  const Action action = actions[random() % actions.size()];
+  controls.doAction(action, !controls.getState(action));
+
+  sky::ParticipationInput input;
+  input.controls = controls;
+  transmit(sky::ClientPacket::ReqInput(inputStream.push(input, uptime)));
+}
+
+SyntheticClient::SyntheticClient(tg::Telegraph<sky::ServerPacket> &telegraph,
+                                 const std::string &nickname,
+                                 const std::string &hostname,
+                                 const Port port,
+                                 const unsigned int seed) :
+    SyntheticClient(std::make_unique<tg::ENetTransport>(tg::HostType::Client, 0),
+                    telegraph, nickname, hostname, port, seed) { }
+
+SyntheticClient::SyntheticClient(std::unique_ptr<tg::Transport> &&transport,
+                                 tg::Telegraph<sky::ServerPacket> &telegraph,
+                                 const std::string &nickname,
+                                 const std::string &hostname,
+                                 const Port port,
+                                 const unsigned int seed) :
+    host(std::move(transport)),
+    telegraph(telegraph),
+    server(nullptr),
+    nickname(nickname),
+    random(seed),
+
+    state(SyntheticState::Connecting),
+    skyRunning(false),
+    skyRequestTimeout(2),
+    spawnSchedule(3),
+    skyAckSchedule(1.0f / 10.0f),
+    controlSchedule(0.25f),
+
+    uptime(0),
+    arena(0),
+    deltaDelay(100),
+    deltasReceived(0) {
+  host.connect(hostname, port);
+}
+
+SyntheticState SyntheticClient::getState() const {
+  return state;
+}
+
+optional<tg::PeerStats> SyntheticClient::linkStats() const {
+  if (!server) return {};
+  return host.peerStats(server);
+}
+
+void SyntheticClient::poll() {
+  if (state == SyntheticState::Disconnected) return;
+
+  for (;;) {
+    const ENetEvent event = host.poll();
+    switch (event.type) {
+      case ENET_EVENT_TYPE_NONE:
+        return;
+      case ENET_EVENT_TYPE_CONNECT: {
+        server = event.peer;
+        state = SyntheticState::Joining;
+        transmit(sky::ClientPacket::ReqJoin(nickname, arena));
+        break;
+      }
+      case ENET_EVENT_TYPE_DISCONNECT: {
+        server = nullptr;
+        state = SyntheticState::Disconnected;
+        appLog(nickname + " was disconnected!", LogOrigin::Client);
+        return;
+      }
+      case ENET_EVENT_TYPE_RECEIVE: {
+        telegraph.receive(event.packet, [&](sky::ServerPacket &&packet) {
+          processPacket(std::move(packet));
+        });
+        enet_packet_destroy(event.packet);
+        break;
+      }
+    }
+  }
+}
+
+void SyntheticClient::tick(const TimeDiff delta) {
+  uptime += delta;
+  host.tick(delta);
+
+  switch (state) {
+    case SyntheticState::Lobby: {
+      // We have no environment to load, ask for the sky right away.
+      if (skyRunning) {
+        transmit(sky::ClientPacket::ReqSky());
+        state = SyntheticState::LoadingSky;
+        skyRequestTimeout.reset();
+      }
+      break;
+    }
+
+    case SyntheticState::LoadingSky: {
+      // The server ignores ReqSky while its sky is still starting.
+      if (skyRequestTimeout.tick(delta)) {
+        transmit(sky::ClientPacket::ReqSky());
+        skyRequestTimeout.reset();
+      }
+      break;
+    }
+
+    case SyntheticState::Playing: {
+      // Spawning again periodically, in case we died.
+      if (spawnSchedule.tick(delta)) {
+        transmit(sky::ClientPacket::ReqSpawn());
+        spawnSchedule.reset();
+      }
+
+      if (controlSchedule.tick(delta)) {
+        randomizeControls();
+        controlSchedule = Scheduler(0.1f + 0.5f * (random() % 100) / 100.0f);
+      }
+
+      if (skyAckSchedule.tick(delta)) {
+        if (lastSequence and lastSequence != transmittedAck)
+          transmit(sky::ClientPacket::AckSky(lastSequence.get()));
+        skyAckSchedule.reset();
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+void SyntheticClient::rcon(const std::string &command) {
+  transmit(sky::ClientPacket::RCon(command));
+}
+
+void SyntheticClient::disconnect() {
+  if (server) host.disconnect(server);
+}
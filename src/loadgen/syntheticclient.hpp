@@ -0,0 +1,99 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * A headless client that joins a server and plays with random controls.
+ */
+#pragma once
+#include <random>
+#include "util/telegraph.hpp"
+#include "engine/protocol.hpp"
+
+/**
+ * Where a SyntheticClient is in the connection protocol.
+ */
+enum class SyntheticState {
+  Connecting, // waiting for the ENet connection
+  Joining, // sent ReqJoin, waiting for Init
+  Lobby, // in the arena, no game running
+  LoadingSky, // sent ReqSky, waiting for InitSky
+  Playing, // receiving sky deltas and sending inputs
+  Disconnected
+};
+
+/**
+ * One synthetic player. It runs the real join handshake, asks for the sky
+ * when a game is running, spawns, and streams randomized controls. It keeps
+ * no engine state: it only measures what the server sends it.
+ *
+ * Delta delay is how much later than on the fastest path seen so far a sky
+ * delta arrives, given its server timestamp. It includes queueing on the
+ * link and in the server, but not the base latency.
+ */
+class SyntheticClient {
+ private:
+  tg::Host host;
+  tg::Telegraph<sky::ServerPacket> &telegraph;
+  ENetPeer *server;
+  const std::string nickname;
+  std::mt19937 random;
+
+  // Protocol state.
+  SyntheticState state;
+  bool skyRunning; // the server has a game going
+  optional<sky::SkySequence> lastSequence, transmittedAck;
+  Scheduler skyRequestTimeout, spawnSchedule, skyAckSchedule;
+  Scheduler controlSchedule;
+  sky::PlaneControls controls;
+  sky::InputStream inputStream;
+
+  // Clock, and the lowest offset seen from server timestamps.
+  Time uptime;
+  optional<Time> minOffset;
+  void observeTimestamp(const Time timestamp);
+
+  void transmit(sky::ClientPacket packet);
+  void processPacket(sky::ServerPacket &&packet);
+  void randomizeControls();
+
+ public:
+  SyntheticClient(tg::Telegraph<sky::ServerPacket> &telegraph,
+                  const std::string &nickname,
+                  const std::string &hostname, const Port port,
+                  const unsigned int seed);
+  SyntheticClient(std::unique_ptr<tg::Transport> &&transport,
+                  tg::Telegraph<sky::ServerPacket> &telegraph,
+                  const std::string &nickname,
+                  const std::string &hostname, const Port port,
+                  const unsigned int seed);
+
+  sky::ArenaID arena; // to ask for when joining
+
+  // Stats.
+  RollingSampler<TimeDiff> deltaDelay;
+  size_t deltasReceived;
+
+  SyntheticState getState() const;
+  optional<tg::PeerStats> linkStats() const;
+
+  // User API.
+  void poll(); // handle everything the network has for us
+  void tick(const TimeDiff delta);
+  void rcon(const std::string &command);
+  void disconnect();
+
+};
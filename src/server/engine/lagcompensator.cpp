@@ -0,0 +1,112 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include "lagcompensator.hpp"
+
+/**
+ * LagCompensator.
+ */
+
+void LagCompensator::registerPlayer(sky::Player &player) {
+  // The default depth holds a little over half a second of 60 Hz ticks.
+  histories.emplace(std::piecewise_construct,
+                    std::forward_as_tuple(player.pid),
+                    std::forward_as_tuple());
+  setPlayerData(player, histories.at(player.pid));
+}
+
+void LagCompensator::unregisterPlayer(sky::Player &player) {
+  histories.erase(player.pid);
+  viewDelays.erase(player.pid);
+}
+
+void LagCompensator::onSpawn(sky::Player &player) {
+  getPlayerData(player).clear();
+}
+
+void LagCompensator::onKill(sky::Player &player) {
+  getPlayerData(player).clear();
+}
+
+LagCompensator::LagCompensator(sky::Arena &arena, sky::SkyHandle &skyHandle,
+                               const TimeDiff maxRewind,
+                               const TimeDiff defaultViewDelay) :
+    sky::Subsystem<sky::PhysicalHistory>(arena),
+    skyHandle(skyHandle),
+    maxRewind(maxRewind),
+    defaultViewDelay(defaultViewDelay) {
+  arena.forPlayers([&](sky::Player &player) {
+    registerPlayer(player);
+  });
+}
+
+void LagCompensator::record() {
+  if (const auto sky = skyHandle.getSky()) {
+    for (auto &pair : sky->participations) {
+      if (const auto &plane = pair.second.plane) {
+        getPlayerData(pair.second.player).record(
+            arena.getUptime(), plane->getState().physical);
+      }
+    }
+  }
+}
+
+void LagCompensator::registerViewDelay(const sky::Player &player,
+                                       const TimeDiff delay) {
+  if (!std::isfinite(delay)) return; // it comes from the client
+  viewDelays[player.pid] = clamp(0.0f, maxRewind, delay);
+}
+
+Time LagCompensator::viewTime(const sky::Player &player) const {
+  const auto reported = viewDelays.find(player.pid);
+  const TimeDiff viewDelay = reported != viewDelays.end() ?
+                             reported->second : defaultViewDelay;
+  const Time now = arena.getUptime();
+  return now - std::min(player.getLatency() + viewDelay, maxRewind);
+}
+
+sky::Player *LagCompensator::hitscan(const sky::Player &shooter,
+                                     const float range) {
+  const auto sky = skyHandle.getSky();
+  if (!sky) return nullptr;
+  const auto &shooterPlane = sky->getParticipation(shooter).plane;
+  if (!shooterPlane) return nullptr;
+
+  // The shooter's own plane is where they say it is; everyone else, where
+  // they saw them.
+  const auto &origin = shooterPlane->getState().physical;
+  const Time time = viewTime(shooter);
+
+  sky::Player *target = nullptr;
+  float closest = range;
+  for (auto &pair : sky->participations) {
+    sky::Player &player = pair.second.player;
+    const auto &plane = pair.second.plane;
+    if (!plane or player.getTeam() == shooter.getTeam()) continue;
+
+    const auto state = getPlayerData(player).rewind(time);
+    if (!state) continue;
+    if (const auto distance = sky::hitscan(
+        origin.pos, origin.rot, closest, state.get(),
+        plane->getTuning().hitbox)) {
+      closest = distance.get();
+      target = &player;
+    }
+  }
+  return target;
+}
@@ -0,0 +1,60 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Server-side subsystem rewinding planes to what a player saw of them.
+ */
+#pragma once
+#include "engine/arena.hpp"
+#include "engine/sky/skyhandle.hpp"
+#include "engine/sky/statehistory.hpp"
+
+/**
+ * Keeps a short history of every plane, so weapons can judge hits against
+ * where the shooter saw the other planes instead of where they are now.
+ * Clients see the sky about a round trip plus their interpolation delay
+ * late; they tell us the latter with their pongs.
+ */
+class LagCompensator: public sky::Subsystem<sky::PhysicalHistory> {
+ private:
+  sky::SkyHandle &skyHandle;
+  std::map<PID, sky::PhysicalHistory> histories;
+  std::map<PID, TimeDiff> viewDelays; // as clients last reported them
+
+ protected:
+  void registerPlayer(sky::Player &player) override final;
+  void unregisterPlayer(sky::Player &player) override final;
+  void onSpawn(sky::Player &player) override final;
+  void onKill(sky::Player &player) override final;
+
+ public:
+  LagCompensator(sky::Arena &arena, sky::SkyHandle &skyHandle,
+                 const TimeDiff maxRewind = 0.5,
+                 const TimeDiff defaultViewDelay = 0.1);
+
+  const TimeDiff maxRewind; // no further back than this, whatever the ping
+  const TimeDiff defaultViewDelay; // until a client reports its own
+
+  void record(); // once the sky has ticked
+  void registerViewDelay(const sky::Player &player, const TimeDiff delay);
+
+  // When the sky that a player sees now was the server's present.
+  Time viewTime(const sky::Player &player) const;
+  // The closest plane of another team a player hits in their view, if any.
+  sky::Player *hitscan(const sky::Player &shooter, const float range);
+
+};
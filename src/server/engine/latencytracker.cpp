@@ -22,22 +22,20 @@
  */
 
 PlayerLatency::PlayerLatency() :
-    latencySampler(5),
-    offsetSampler(5) { }
+    sync(32, 8) { }
 
 void PlayerLatency::registerPong(const Time now,
                                  const Time pingTime,
                                  const Time pongTime) {
-  latencySampler.push(TimeDiff(now - pingTime));
-  offsetSampler.push(pongTime - (pingTime + (getLatency() / 2)));
+  sync.registerExchange(pingTime, pongTime, now);
 }
 
-TimeDiff PlayerLatency::getLatency() {
-  return latencySampler.mean<TimeDiff>();
+TimeDiff PlayerLatency::getLatency() const {
+  return sync.roundTrip();
 }
 
-Time PlayerLatency::getOffset() {
-  return offsetSampler.mean<Time>();
+Time PlayerLatency::getOffset(const Time now) const {
+  return sync.offset(now);
 }
 
 /**
@@ -73,7 +71,7 @@ sky::ArenaDelta LatencyTracker::makeUpdate() {
     sky::PlayerDelta playerDelta{player};
     auto &latency = getPlayerData(player);
     playerDelta.latencyStats.emplace(latency.getLatency(),
-                                     latency.getOffset());
+                                     latency.getOffset(arena.getUptime()));
     deltas.emplace(player.pid, playerDelta);
   });
   return sky::ArenaDelta::Delta(deltas);
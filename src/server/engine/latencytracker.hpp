@@ -21,14 +21,14 @@
 #pragma once
 #include "engine/arena.hpp"
 #include "util/types.hpp"
+#include "util/clocksync.hpp"
 
 /**
  * Latency data for a player.
  */
 struct PlayerLatency {
  private:
-  RollingSampler<TimeDiff> latencySampler;
-  RollingSampler<Time> offsetSampler;
+  ClockSync sync;
 
  public:
   PlayerLatency();
@@ -37,8 +37,8 @@ struct PlayerLatency {
                     const Time pingTime,
                     const Time pongTime);
 
-  TimeDiff getLatency();
-  Time getOffset();
+  TimeDiff getLatency() const;
+  Time getOffset(const Time now) const;
 
 };
 
@@ -0,0 +1,276 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "skybroadcaster.hpp"
+
+/**
+ * ClientSkyState.
+ */
+
+ClientSkyState::ClientSkyState(const sky::SkySequence floor) :
+    floor(floor),
+    rate(1.0f / 60.0f, 1.0f / 10.0f, 1.0f / 25.0f) { }
+
+void ClientSkyState::reset(const sky::SkySequence newFloor) {
+  // What we learned about the client's link stays valid.
+  ack.reset();
+  floor = newFloor;
+  skippedSince.reset();
+  interest = SkyInterest();
+}
+
+/**
+ * PendingBroadcast.
+ */
+
+PendingBroadcast::PendingBroadcast(
+    const sky::SkySequence sequence, const Time uptime,
+    std::vector<Group> &&groups) :
+    sequence(sequence),
+    uptime(uptime),
+    captured(std::chrono::steady_clock::now()),
+    groups(std::move(groups)),
+    encoded(this->groups.size()) { }
+
+void PendingBroadcast::encode(Group &group,
+                              const optional<size_t> compressionThreshold) {
+  auto &telegraph = *group.telegraph;
+  telegraph.compression.threshold = compressionThreshold;
+  telegraph.traffic.reset();
+  telegraph.compression.stats.reset();
+
+  const auto callPeers =
+      [&](std::function<void(ENetPeer *const)> transmit) {
+        for (const auto &recipient : group.recipients)
+          transmit(recipient.first);
+      };
+  if (group.baseline) {
+    telegraph.post(group.outbox, callPeers, sky::ServerPacket::DeltaSky(
+        sky::SnapshotHistory::relativeTo(
+            group.view.apply(*group.delta),
+            group.view.apply(*group.baselineSnapshot)),
+        uptime, sequence, group.baseline));
+  } else {
+    telegraph.post(group.outbox, callPeers, sky::ServerPacket::DeltaSky(
+        group.view.apply(*group.delta), uptime, sequence));
+  }
+
+  group.traffic = telegraph.traffic;
+  group.compression = telegraph.compression.stats;
+}
+
+/**
+ * SkyBroadcaster.
+ */
+
+void SkyBroadcaster::resetClients() {
+  collect(); // (nobody's floor lets the old deltas through)
+  history.clear();
+  skipped.clear();
+  for (auto &client : clients) client.second.reset(nextSequence);
+}
+
+void SkyBroadcaster::registerPlayer(sky::Player &player) {
+  clients.emplace(player.pid, ClientSkyState(nextSequence));
+  setPlayerData(player, clients.find(player.pid)->second);
+}
+
+void SkyBroadcaster::unregisterPlayer(sky::Player &player) {
+  clients.erase(clients.find(player.pid));
+}
+
+void SkyBroadcaster::onStartGame() {
+  resetClients();
+}
+
+void SkyBroadcaster::onEndGame() {
+  resetClients();
+}
+
+SkyBroadcaster::SkyBroadcaster(ServerShared &shared, ThreadPool &encoders) :
+    sky::Subsystem<ClientSkyState>(shared.arena),
+    shared(shared),
+    encoders(encoders),
+    history(64),
+    nextSequence(0),
+    linkSchedule(0.5),
+    outgoingBudgetKbit(8192) {
+  arena.forPlayers([&](sky::Player &player) {
+    registerPlayer(player);
+  });
+}
+
+void SkyBroadcaster::registerAck(const sky::Player &player,
+                                 const sky::SkySequence ack) {
+  auto &client = getPlayerData(player);
+  if (ack < client.floor) return;
+  if (!client.ack or ack > client.ack.get()) client.ack = ack;
+}
+
+void SkyBroadcaster::resetClient(const sky::Player &player) {
+  getPlayerData(player).reset(nextSequence);
+}
+
+void SkyBroadcaster::collect() {
+  if (!pending) return;
+  const auto batch = std::move(pending);
+  pending.reset();
+
+  auto &stats = shared.encodingStats;
+  stats.batches++;
+  if (!batch->encoded.done()) stats.stalls++;
+  batch->encoded.wait();
+
+  for (auto &group : batch->groups) {
+    if (group.error) std::rethrow_exception(group.error);
+
+    // Recipients may have left or reloaded their sky since; check who's
+    // still there and still wants this delta.
+    for (const auto &recipient : group.recipients) {
+      const sky::Player *player = shared.playerFromPeer(recipient.first);
+      const auto client = clients.find(recipient.second);
+      if (!player or player->pid != recipient.second
+          or client == clients.end()
+          or client->second.floor > batch->sequence)
+        group.outbox.drop(recipient.first);
+    }
+
+    shared.outbox.append(std::move(group.outbox));
+    shared.telegraph.traffic.merge(group.traffic);
+    shared.telegraph.compression.stats.merge(group.compression);
+  }
+
+  stats.latency.push(std::chrono::duration<TimeDiff>(
+      std::chrono::steady_clock::now() - batch->captured).count());
+}
+
+void SkyBroadcaster::tick(const TimeDiff delta) {
+  for (auto &client : clients) client.second.rate.tick(delta);
+
+  if (linkSchedule.tick(delta)) {
+    // The host counts kilobytes.
+    const float outgoingKbit = 8 * shared.host.outgoingBandwidth();
+    const float budgetUse = outgoingKbit / outgoingBudgetKbit;
+    for (const auto peer : shared.clients) {
+      sky::Player *player = shared.playerFromPeer(peer);
+      const auto link = shared.host.linkQuality(peer);
+      if (player and link) getPlayerData(*player).rate.update(*link, budgetUse);
+    }
+    linkSchedule.reset();
+  }
+}
+
+void SkyBroadcaster::broadcast(const sky::SkyDelta &delta) {
+  const sky::SkySequence sequence = nextSequence++;
+  history.record(sequence, delta);
+
+  sky::Sky *sky = shared.skyHandle.getSky();
+  if (!sky) return;
+
+  const auto current = std::make_shared<const sky::SkyDelta>(delta);
+  skipped.emplace(sequence, current);
+
+  // What clients skipped since some delta get instead of this one; computed
+  // once for all those skipped since the same one.
+  std::map<sky::SkySequence, std::shared_ptr<const sky::SkyDelta>> catchUps;
+  catchUps.emplace(sequence, current);
+  const auto catchUp = [&](const sky::SkySequence since) {
+    auto &folded = catchUps[since];
+    if (!folded) {
+      auto missed = skipped.find(since);
+      sky::SkyDelta merged{*missed->second};
+      for (++missed; missed != skipped.end(); ++missed)
+        merged.absorb(*missed->second);
+      folded = std::make_shared<const sky::SkyDelta>(std::move(merged));
+    }
+    return folded;
+  };
+
+  // Group loaded clients by what they missed, the baseline we can encode
+  // against, and the part of the delta they get to see.
+  const bool events = delta.carriesEvents();
+  using GroupKey = std::tuple<
+      sky::SkySequence, optional<sky::SkySequence>, SkyView>;
+  std::map<GroupKey, std::vector<ENetPeer *>> groups;
+  for (const auto peer : shared.clients) {
+    if (sky::Player *player = shared.playerFromPeer(peer)) {
+      if (player->isLoadingEnv()) continue;
+
+      auto &client = getPlayerData(*player);
+      if (!events and !client.rate.due()) {
+        if (!client.skippedSince) client.skippedSince = sequence;
+        continue;
+      }
+      client.rate.reset();
+      const auto since = client.skippedSince.get_value_or(sequence);
+      client.skippedSince.reset();
+
+      optional<sky::SkySequence> baseline;
+      if (client.ack and history.find(client.ack.get())) baseline = client.ack;
+      groups[GroupKey(since, baseline, client.interest.view(
+          *sky, *player, sequence, baseline, *catchUp(since)))].push_back(peer);
+    }
+  }
+
+  // Only keep what someone still has to catch up on.
+  optional<sky::SkySequence> oldest;
+  for (const auto &client : clients) {
+    const auto &since = client.second.skippedSince;
+    if (since and (!oldest or since.get() < oldest.get())) oldest = since;
+  }
+  skipped.erase(skipped.begin(),
+                oldest ? skipped.find(oldest.get()) : skipped.end());
+
+  if (groups.empty()) return;
+
+  // Capture everything the encoding needs, and hand it to the workers.
+  std::vector<PendingBroadcast::Group> captured(groups.size());
+  while (telegraphs.size() < captured.size())
+    telegraphs.push_back(std::make_shared<tg::Telegraph<sky::ClientPacket>>());
+
+  auto group = groups.begin();
+  auto telegraph = telegraphs.begin();
+  for (auto &capture : captured) {
+    capture.telegraph = *telegraph++;
+    capture.delta = catchUps.at(std::get<0>(group->first));
+    capture.baseline = std::get<1>(group->first);
+    if (capture.baseline)
+      capture.baselineSnapshot = history.share(capture.baseline.get());
+    capture.view = std::get<2>(group->first);
+    for (const auto peer : group->second)
+      capture.recipients.emplace_back(peer, shared.playerFromPeer(peer)->pid);
+    ++group;
+  }
+
+  collect(); // at most one batch in flight
+  pending = std::make_shared<PendingBroadcast>(
+      sequence, shared.arena.getUptime(), std::move(captured));
+
+  const auto threshold = shared.telegraph.compression.threshold;
+  for (auto &capture : pending->groups) {
+    const auto batch = pending;
+    PendingBroadcast::Group *const encoding = &capture;
+    encoders.run([batch, encoding, threshold]() {
+      try {
+        batch->encode(*encoding, threshold);
+      } catch (...) {
+        encoding->error = std::current_exception();
+      }
+      batch->encoded.countDown();
+    });
+  }
+}
@@ -0,0 +1,124 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Sky delta broadcasting subsystem for use by ServerExec.
+ */
+#pragma once
+#include "server/servershared.hpp"
+#include "engine/sky/snapshothistory.hpp"
+#include "skyinterest.hpp"
+#include "util/threads.hpp"
+
+/**
+ * What we know about the sky deltas a client has received.
+ */
+struct ClientSkyState {
+  ClientSkyState(const sky::SkySequence floor = 0);
+
+  optional<sky::SkySequence> ack; // latest DeltaSky the client acknowledged
+  sky::SkySequence floor; // acks below this predate the client's current sky
+  optional<sky::SkySequence> skippedSince; // first delta it wasn't sent
+  SkyInterest interest;
+  tg::RateControl rate; // how often it gets deltas that only carry state
+
+  void reset(const sky::SkySequence newFloor); // for a new sky
+};
+
+/**
+ * The sky deltas of one tick, being encoded on workers. Jobs only read what
+ * they share and write to their own group.
+ */
+struct PendingBroadcast {
+  struct Group {
+    std::vector<std::pair<ENetPeer *, PID>> recipients;
+    std::shared_ptr<const sky::SkyDelta> delta;
+    SkyView view;
+    optional<sky::SkySequence> baseline;
+    std::shared_ptr<const sky::SkySnapshot> baselineSnapshot;
+    std::shared_ptr<tg::Telegraph<sky::ClientPacket>> telegraph; // ours alone
+
+    // Results.
+    tg::Outbox outbox;
+    tg::TrafficStats traffic;
+    tg::CompressionStats compression;
+    std::exception_ptr error;
+  };
+
+  PendingBroadcast(const sky::SkySequence sequence, const Time uptime,
+                   std::vector<Group> &&groups);
+
+  const sky::SkySequence sequence;
+  const Time uptime;
+  const std::chrono::steady_clock::time_point captured;
+  std::vector<Group> groups;
+  Latch encoded;
+
+  void encode(Group &group, const optional<size_t> compressionThreshold);
+};
+
+/**
+ * Sends SkyDeltas to loaded clients, filtered to their area of interest and
+ * relative to the last delta each of them acknowledged when we still have it
+ * in our history. Clients sharing a baseline and a view share one encoded
+ * packet.
+ *
+ * Deltas are collected every tick. Those carrying events go to everyone at
+ * once; the others only to clients whose adaptive send interval is up. A
+ * client that was skipped gets the deltas it missed folded into the next
+ * one it's sent, since they can carry changes and removals only once.
+ *
+ * Grouping happens in the tick; encoding happens on a thread pool while
+ * the arena goes on with the next tick, which starts by collecting the
+ * results. Deltas go out one tick later than they would inline.
+ */
+class SkyBroadcaster: public sky::Subsystem<ClientSkyState> {
+ private:
+  ServerShared &shared;
+  ThreadPool &encoders;
+  std::shared_ptr<PendingBroadcast> pending;
+  std::map<PID, ClientSkyState> clients;
+  sky::SnapshotHistory history;
+  // One for each group slot, reused by every broadcast; only one is in
+  // flight at a time.
+  std::vector<std::shared_ptr<tg::Telegraph<sky::ClientPacket>>> telegraphs;
+  // Deltas since the oldest one some client was skipped for.
+  std::map<sky::SkySequence, std::shared_ptr<const sky::SkyDelta>> skipped;
+  sky::SkySequence nextSequence;
+  Scheduler linkSchedule;
+
+  void resetClients();
+
+ protected:
+  void registerPlayer(sky::Player &player) override final;
+  void unregisterPlayer(sky::Player &player) override final;
+  void onStartGame() override final;
+  void onEndGame() override final;
+
+ public:
+  SkyBroadcaster(ServerShared &shared, ThreadPool &encoders);
+
+  void registerAck(const sky::Player &player, const sky::SkySequence ack);
+  void resetClient(const sky::Player &player);
+
+  float outgoingBudgetKbit; // kilobits per second, server-wide
+
+  void collect(); // send what the last broadcast encoded
+  void tick(const TimeDiff delta);
+  void broadcast(const sky::SkyDelta &delta);
+
+};
@@ -23,11 +23,14 @@ namespace sky {
  * PlayerInputManager.
  */
 PlayerInputManager::PlayerInputManager(sky::Player &player, ServerShared &shared) :
-    player(player), shared(shared), arena(shared.arena), inputControl({}) { }
+    player(player), shared(shared), arena(shared.arena),
+    // Inputs come in several times over, so a late copy is usually covered.
+    inputControl(std::make_unique<AdaptivePolicy>(0.9)) { }
 
-void PlayerInputManager::cacheInput(const Time timestamp,
-                                    const sky::ParticipationInput &input) {
-  inputControl.registerMessage(arena.getUptime(), timestamp, input);
+void PlayerInputManager::cacheInput(SequencedInput &&input) {
+  if (!inputFilter.accept(input)) return;
+  inputControl.registerMessage(arena.getUptime(), input.timestamp,
+                               std::move(input));
 }
 
 void PlayerInputManager::poll() {
@@ -61,9 +64,9 @@ SkyInputManager::SkyInputManager(ServerShared &shared) :
     Subsystem(shared.arena), shared(shared) { }
 
 void SkyInputManager::receive(
-    sky::Player &player, const Time timestamp,
-    const sky::ParticipationInput &input) {
-  getPlayerData(player).cacheInput(timestamp, input);
+    sky::Player &player, std::vector<SequencedInput> &&inputs) {
+  auto &manager = getPlayerData(player);
+  for (auto &input : inputs) manager.cacheInput(std::move(input));
 }
 
 }
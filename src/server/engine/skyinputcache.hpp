@@ -21,6 +21,7 @@
 #pragma once
 #include "server/servershared.hpp"
 #include "engine/flowcontrol.hpp"
+#include "engine/sky/inputstream.hpp"
 
 namespace sky {
 
@@ -33,12 +34,13 @@ class PlayerInputManager {
   ServerShared &shared;
   Arena &arena;
 
-  FlowControl<sky::ParticipationInput> inputControl;
+  FlowControl<SequencedInput> inputControl;
+  InputFilter inputFilter; // inputs come in several times over
 
  public:
   PlayerInputManager(sky::Player &player, ServerShared &shared);
 
-  void cacheInput(const Time timestamp, const sky::ParticipationInput &input);
+  void cacheInput(SequencedInput &&input);
   void poll();
 
 };
@@ -57,8 +59,7 @@ class SkyInputManager: public Subsystem<PlayerInputManager> {
  public:
   SkyInputManager(ServerShared &shared);
 
-  void receive(sky::Player &player, const Time timestamp,
-               const sky::ParticipationInput &input);
+  void receive(sky::Player &player, std::vector<SequencedInput> &&inputs);
 
 };
 
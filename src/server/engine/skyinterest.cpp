@@ -0,0 +1,135 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "skyinterest.hpp"
+
+namespace {
+
+/**
+ * Where the view of a client is centered, mirroring SkyRender.
+ */
+float viewCenter(const float viewWidth, const float totalWidth,
+                 const float target) {
+  if (totalWidth < viewWidth) return totalWidth / 2;
+  return clamp(viewWidth / 2, totalWidth - (viewWidth / 2), target);
+}
+
+}
+
+/**
+ * SkyView.
+ */
+
+sky::SkyDelta SkyView::apply(const sky::SkyDelta &delta) const {
+  sky::SkyDelta filtered{delta};
+  for (const PID pid : hiddenPlanes) filtered.participations.erase(pid);
+  if (filtered.entities) {
+    for (const PID pid : hiddenEntities) {
+      // Absence would mean destruction, no delta means no change.
+      const auto entity = filtered.entities->second.find(pid);
+      if (entity != filtered.entities->second.end()) entity->second.reset();
+    }
+  }
+  return filtered;
+}
+
+sky::SkySnapshot SkyView::apply(const sky::SkySnapshot &baseline) const {
+  sky::SkySnapshot filtered{baseline};
+  for (const PID pid : fullPlanes) filtered.planes.erase(pid);
+  return filtered;
+}
+
+bool operator<(const SkyView &x, const SkyView &y) {
+  return std::tie(x.hiddenPlanes, x.hiddenEntities, x.fullPlanes)
+      < std::tie(y.hiddenPlanes, y.hiddenEntities, y.fullPlanes);
+}
+
+/**
+ * SkyInterest.
+ */
+
+constexpr float SkyInterest::enterMargin, SkyInterest::exitMargin;
+constexpr size_t SkyInterest::refreshInterval;
+
+SkyInterest::SkyInterest() :
+    views(0) { }
+
+SkyView SkyInterest::view(sky::Sky &sky, const sky::Player &player,
+                          const sky::SkySequence sequence,
+                          const optional<sky::SkySequence> &baseline,
+                          const sky::SkyDelta &delta) {
+  SkyView view;
+  const bool refresh = views++ % refreshInterval == 0;
+
+  // The client's view, if it has a plane to center it on.
+  optional<sf::Vector2f> center;
+  const float viewscale = sky.settings.getViewscale();
+  const sf::Vector2f viewDims{1600 / viewscale, 900 / viewscale};
+  if (const auto &plane = sky.getParticipation(player).plane) {
+    const auto &pos = plane->getState().physical.pos;
+    const auto &mapDims = sky.getMap().getDimensions();
+    center.emplace(viewCenter(viewDims.x, mapDims.x, pos.x),
+                   viewCenter(viewDims.y, mapDims.y, pos.y));
+  }
+
+  const auto isRelevant = [&](std::set<PID> &relevant, const PID pid,
+                              const sf::Vector2f &pos) {
+    if (!center) return true;
+    const float margin = relevant.count(pid) ? exitMargin : enterMargin;
+    const bool inside =
+        std::abs(pos.x - center->x) < (viewDims.x / 2) + margin
+            and std::abs(pos.y - center->y) < (viewDims.y / 2) + margin;
+    if (inside) relevant.insert(pid);
+    else relevant.erase(pid);
+    return inside;
+  };
+
+  for (const auto &participation : delta.participations) {
+    const PID pid = participation.first;
+    const auto &pDelta = participation.second;
+    const bool stateOnly = !pDelta.carriesEvents();
+
+    bool relevant = true;
+    if (pid != player.pid) {
+      if (const auto otherPlayer = sky.arena.getPlayer(pid)) {
+        if (const auto &plane = sky.getParticipation(*otherPlayer).plane)
+          relevant = isRelevant(planes, pid, plane->getState().physical.pos);
+      }
+    }
+
+    if (stateOnly and !relevant and !refresh) {
+      view.hiddenPlanes.insert(pid);
+      planeRuns.erase(pid);
+    } else {
+      // The client only has this plane in its baseline if we haven't
+      // left it out of anything since.
+      const auto run = planeRuns.emplace(pid, sequence).first;
+      if (baseline and run->second > baseline.get())
+        view.fullPlanes.insert(pid);
+    }
+  }
+
+  if (delta.entities) {
+    for (const auto &entity : delta.entities->second) {
+      if (entity.second and !refresh
+          and !isRelevant(entities, entity.first, entity.second->physical.pos))
+        view.hiddenEntities.insert(entity.first);
+    }
+  }
+
+  return view;
+}
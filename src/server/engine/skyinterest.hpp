@@ -0,0 +1,65 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Area of interest filtering for SkyDeltas, for use by SkyBroadcaster.
+ */
+#pragma once
+#include <set>
+#include "engine/sky/sky.hpp"
+#include "engine/sky/snapshothistory.hpp"
+
+/**
+ * How one client sees a SkyDelta: what we leave out, and which plane states
+ * can't be sent relative to its baseline.
+ */
+struct SkyView {
+  std::set<PID> hiddenPlanes, hiddenEntities, fullPlanes;
+
+  sky::SkyDelta apply(const sky::SkyDelta &delta) const;
+  sky::SkySnapshot apply(const sky::SkySnapshot &baseline) const;
+};
+
+bool operator<(const SkyView &x, const SkyView &y);
+
+/**
+ * The area of interest of a client: the part of the map around its view.
+ * Things outside it have their state updates down-rated; events (spawns,
+ * kills, control changes, component creation) always go through.
+ */
+class SkyInterest {
+ private:
+  // Relevant planes and entities; the margin to enter the set is smaller
+  // than the one to leave it, so nothing flickers on the edge of the view.
+  std::set<PID> planes, entities;
+  // Sequence since which each plane has been sent without interruption.
+  std::map<PID, sky::SkySequence> planeRuns;
+  size_t views; // deltas this client has been sent
+
+ public:
+  SkyInterest();
+
+  static constexpr float enterMargin = 200, exitMargin = 400;
+  // Irrelevant states still go out once every so many deltas.
+  static constexpr size_t refreshInterval = 8;
+
+  SkyView view(sky::Sky &sky, const sky::Player &player,
+               const sky::SkySequence sequence,
+               const optional<sky::SkySequence> &baseline,
+               const sky::SkyDelta &delta);
+
+};
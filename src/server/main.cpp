@@ -17,17 +17,29 @@
  */
 /**
  * Server top-level.
+ *
+ * usage: solemnsky_server [port] [arenas] [tick rate]
  */
 #include "server.hpp"
 #include "servers/vanilla.hpp"
 
-int main() {
-  // TODO: commandline arguments
+int main(int argc, char **argv) {
+  const Port port = argc > 1 ? Port(std::stoul(argv[1])) : 4242;
+  const size_t arenaCount = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 1;
+  const unsigned int tickRate = argc > 3 ? std::max(1u, unsigned(std::stoul(argv[3]))) : 60;
+
+  std::vector<sky::ArenaInit> arenas;
+  for (size_t i = 0; i < arenaCount; i++) {
+    arenas.emplace_back(
+        arenaCount > 1 ? "my special server " + std::to_string(i)
+                       : "my special server",
+        "asteroids");
+  }
 
   // and He said,
-  ServerExec(4242, sky::ArenaInit("my special server", "asteroids"),
+  ServerExec(port, arenas,
              [](ServerShared &shared) {
                return std::make_unique<VanillaServer>(shared);
-      }).run();
+      }, 0, tickRate).run();
   // and lo, there appeared a server
 }
@@ -15,6 +15,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
 #include "server.hpp"
 
 /**
@@ -29,134 +30,122 @@ ServerLogger::ServerLogger(ServerShared &shared, sky::Arena &arena) :
     sky::ArenaLogger(arena), shared(shared) { }
 
 /**
- * ServerExec.
+ * ServerArena.
  */
 
-void ServerExec::processPacket(ENetPeer *client,
-                               const sky::ClientPacket &packet) {
+void ServerArena::join(ENetPeer *client, const sky::ClientPacket &packet) {
   using namespace sky;
 
-  if (Player *const player = shared.playerFromPeer(client)) {
-    // the player is in the arena
+  const ArenaDelta delta = shared.arena.connectPlayer(packet.stringData.get());
+  Player *newPlayer = shared.arena.getPlayer(delta.join->pid);
+  client->data = newPlayer;
+  shared.clients.push_back(client);
+
+  shared.logEvent(ServerEvent::Connect(newPlayer->getNickname()));
+  shared.sendToClient(client, ServerPacket::Init(
+      newPlayer->pid,
+      shared.arena.captureInitializer(),
+      shared.skyHandle.captureInitializer(),
+      shared.scoreboard.captureInitializer()));
+  shared.sendToClientsExcept(
+      newPlayer->pid, ServerPacket::DeltaArena(delta));
+}
 
-    switch (packet.type) {
-      case ClientPacket::Type::ReqSky: {
-        if (auto sky = shared.skyHandle.getSky()) {
-          shared.sendToClient(
-              client, sky::ServerPacket::InitSky(sky->captureInitializer()));
+void ServerArena::processPacket(ENetPeer *client,
+                                sky::ClientPacket &&packet) {
+  using namespace sky;
 
-          sky::PlayerDelta delta{*player};
-          delta.loadingEnv = false;
-          shared.registerArenaDelta(
-              sky::ArenaDelta::Delta(player->pid, delta));
-        }
-        break;
-      }
+  Player *const player = shared.playerFromPeer(client);
+  if (!player) return;
 
-      case ClientPacket::Type::Pong: {
-        latencyTracker.registerPong(*player,
-                                    packet.pingTime.get(),
-                                    packet.pongTime.get());
-        break;
-      }
+  if (packet.skyAck) skyBroadcaster.registerAck(*player, packet.skyAck.get());
 
-      case ClientPacket::Type::ReqPlayerDelta: {
-        const PlayerDelta &delta = packet.playerDelta.get();
-        sky::PlayerDelta effectedDelta;
-        if (delta.admin) {
-          if (player->isAdmin()) effectedDelta.admin = delta.admin;
-        }
-        if (delta.nickname) {
-          effectedDelta.nickname =
-              shared.arena.allocNewNickname(*player, delta.nickname.get());
-        }
+  switch (packet.type) {
+    case ClientPacket::Type::ReqSky: {
+      if (auto sky = shared.skyHandle.getSky()) {
+        skyBroadcaster.resetClient(*player);
+        shared.sendToClient(
+            client, sky::ServerPacket::InitSky(sky->captureInitializer()));
+
+        sky::PlayerDelta delta{*player};
+        delta.loadingEnv = false;
         shared.registerArenaDelta(
-            sky::ArenaDelta::Delta(
-                player->pid, effectedDelta));
-        break;
+            sky::ArenaDelta::Delta(player->pid, delta));
       }
+      break;
+    }
 
-      case ClientPacket::Type::ReqInput: {
-        inputManager.receive(*player, packet.timestamp.get(),
-                             packet.participationInput.get());
-        break;
-      }
+    case ClientPacket::Type::Pong: {
+      latencyTracker.registerPong(*player,
+                                  packet.pingTime.get(),
+                                  packet.pongTime.get());
+      shared.lagCompensator.registerViewDelay(*player,
+                                              packet.viewDelay.get());
+      break;
+    }
 
-      case ClientPacket::Type::Chat: {
-        shared.sendToClients(sky::ServerPacket::Chat(
-            player->pid, packet.stringData.get()));
-        break;
+    case ClientPacket::Type::ReqPlayerDelta: {
+      const PlayerDelta &delta = packet.playerDelta.get();
+      sky::PlayerDelta effectedDelta;
+      if (delta.admin) {
+        if (player->isAdmin()) effectedDelta.admin = delta.admin;
       }
-
-      case ClientPacket::Type::RCon: {
-        shared.logEvent(ServerEvent::RConIn(packet.stringData.get()));
-        break;
+      if (delta.nickname) {
+        effectedDelta.nickname =
+            shared.arena.allocNewNickname(*player, delta.nickname.get());
       }
-
-      default:
-        break;
+      shared.registerArenaDelta(
+          sky::ArenaDelta::Delta(
+              player->pid, effectedDelta));
+      break;
     }
 
-    server->onPacket(client, *player, packet);
-
-  } else {
-    // client hasn't joined the arena yet
-
-    if (packet.type == ClientPacket::Type::ReqJoin) {
-      const ArenaDelta delta =
-          shared.arena.connectPlayer(packet.stringData.get());
-      Player *newPlayer = shared.arena.getPlayer(delta.join->pid);
-      client->data = newPlayer;
-
-      shared.logEvent(ServerEvent::Connect(newPlayer->getNickname()));
-      shared.sendToClient(client, ServerPacket::Init(
-          newPlayer->pid,
-          shared.arena.captureInitializer(),
-          shared.skyHandle.captureInitializer(),
-          shared.scoreboard.captureInitializer()));
-      shared.sendToClientsExcept(
-          newPlayer->pid, ServerPacket::DeltaArena(delta));
+    case ClientPacket::Type::ReqInput: {
+      // Moved out: listeners have no business with inputs.
+      inputManager.receive(*player, std::move(packet.inputs.get()));
+      break;
     }
-  }
-}
-
-bool ServerExec::poll() {
-  // Network.
-  static ENetEvent event;
-  event = host.poll();
 
-  switch (event.type) {
-    case ENET_EVENT_TYPE_NONE:
-      return true;
-    case ENET_EVENT_TYPE_CONNECT: {
-      appLog("Client connecting...", LogOrigin::Server);
-      event.peer->data = nullptr;
-      return false;
-    }
-    case ENET_EVENT_TYPE_DISCONNECT: {
-      if (sky::Player *player = shared.playerFromPeer(event.peer)) {
-        shared.logEvent(ServerEvent::Disconnect(player->getNickname()));
-        shared.registerArenaDelta(sky::ArenaDelta::Quit(player->pid));
-        event.peer->data = nullptr;
-      }
-      return false;
+    case ClientPacket::Type::Chat: {
+      shared.sendToClients(sky::ServerPacket::Chat(
+          player->pid, packet.stringData.get()));
+      break;
     }
-    case ENET_EVENT_TYPE_RECEIVE: {
-      if (const auto &reception = telegraph.receive(event.packet))
-        processPacket(event.peer, *reception);
-      return false;
+
+    case ClientPacket::Type::RCon: {
+      shared.logEvent(ServerEvent::RConIn(packet.stringData.get()));
+      break;
     }
+
+    default:
+      break;
   }
 
-  return true;
+  server->onPacket(client, *player, packet);
 }
 
-void ServerExec::tick(const TimeDiff delta) {
+void ServerArena::disconnect(ENetPeer *client) {
+  shared.outbox.drop(client);
+  shared.clients.erase(
+      std::remove(shared.clients.begin(), shared.clients.end(), client),
+      shared.clients.end());
+  if (sky::Player *player = shared.playerFromPeer(client)) {
+    shared.logEvent(ServerEvent::Disconnect(player->getNickname()));
+    shared.registerArenaDelta(sky::ArenaDelta::Quit(player->pid));
+    client->data = nullptr;
+  }
+}
+
+void ServerArena::tick(const TimeDiff delta) {
+  // Sky deltas the encoders finished since the last tick go out first.
+  skyBroadcaster.collect();
+
   // Environment loading.
   if (!shared.skyHandle.getSky()) {
     if (auto *environment = shared.skyHandle.getEnvironment()) {
       if (environment->getMap() and environment->getMechanics()) {
         shared.skyHandle.instantiateSky({});
+        shared.skyHandle.getSky()->stateEncoding.emplace();
       } else {
         if (environment->loadingIdle() and !environment->loadingErrored()) {
           environment->loadMore(false, true);
@@ -168,33 +157,21 @@ void ServerExec::tick(const TimeDiff delta) {
   // Tick engine / subsystems forward.
   shared.arena.poll();
   shared.arena.tick(delta);
+  shared.lagCompensator.record();
   // On the server there is no difference in the form that poll() and tick() are called.
 
-  host.tick(delta);
-
   // SkyHandle updating.
   if (const auto handleDelta = shared.skyHandle.collectDelta()) {
     shared.sendToClients(sky::ServerPacket::DeltaSkyHandle(handleDelta.get()));
   }
 
-  // Sky update scheduling.
+  // Sky updates, collected every tick and sent at each client's own rate.
+  // Encoded once per group of clients that see the same thing. Clients sort
+  // out which part of it they have authority over.
   if (const auto sky = shared.skyHandle.getSky()) {
-
-    if (skyDeltaSchedule.tick(delta)) {
-      if (const auto skyDelta = sky->collectDelta()) {
-        for (auto peer : host.getPeers()) {
-          if (sky::Player *player = shared.playerFromPeer(peer)) {
-            if (!player->isLoadingEnv())
-              shared.sendToClient(
-                  peer, sky::ServerPacket::DeltaSky(
-                  skyDelta->respectAuthority(*player),
-                  shared.arena.getUptime()));
-          }
-        }
-        skyDeltaSchedule.reset();
-      }
-    }
-
+    skyBroadcaster.tick(delta);
+    if (const auto skyDelta = sky->collectDelta())
+      skyBroadcaster.broadcast(skyDelta.get());
   }
 
   // Scoreboard update scheduling.
@@ -218,19 +195,19 @@ void ServerExec::tick(const TimeDiff delta) {
     shared.registerArenaDelta(latencyTracker.makeUpdate());
     latencyUpdateSchedule.reset();
   }
-}
 
-ServerExec::ServerExec(
-    const Port port,
-    const sky::ArenaInit &arenaInit,
-    std::function<std::unique_ptr<ServerListener>(
-        ServerShared &)> mkServer) :
+}
 
-    host(tg::HostType::Server, port),
-    shared(host, telegraph, arenaInit),
+ServerArena::ServerArena(const sky::ArenaID id,
+                         const tg::Host &host,
+                         const LoopStats &loopStats,
+                         const sky::ArenaInit &arenaInit,
+                         const MakeServer &mkServer,
+                         ThreadPool &encoders) :
+    id(id),
+    shared(host, telegraph, loopStats, arenaInit),
     inputManager(shared),
 
-    skyDeltaSchedule(1.0f / 25.0f),
     scoreDeltaSchedule(0.5f),
     pingSchedule(1),
     latencyUpdateSchedule(2),
@@ -239,22 +216,171 @@ ServerExec::ServerExec(
 
     logger(shared, shared.arena),
     latencyTracker(shared.arena),
+    skyBroadcaster(shared, encoders) {
+  // Initializers are sent to joining clients during rounds, keep them small.
+  telegraph.compression.threshold = 512;
 
-    running(true) {
+  shared.logEvent(ServerEvent::Start(host.getPort(), arenaInit.name));
+}
+
+/**
+ * ServerExec.
+ */
 
-  time_t current;
-  time(&current);
-  std::srand(current);
+void ServerExec::processEvent(tg::NetworkEvent<sky::ClientPacket> &&event) {
+  switch (event.type) {
+    case ENET_EVENT_TYPE_NONE:
+      break;
+    case ENET_EVENT_TYPE_CONNECT: {
+      appLog("Client connecting...", LogOrigin::Server);
+      event.peer->data = nullptr;
+      break;
+    }
+    case ENET_EVENT_TYPE_DISCONNECT: {
+      const auto route = routes.find(event.peer);
+      if (route != routes.end()) {
+        route->second->disconnect(event.peer);
+        routes.erase(route);
+      }
+      break;
+    }
+    case ENET_EVENT_TYPE_RECEIVE: {
+      sky::ClientPacket &packet = event.message.get();
+      const auto route = routes.find(event.peer);
+      if (route != routes.end()) {
+        ServerArena &arena = *route->second;
+        arena.telegraph.traffic.recordReceived(
+            sky::messageKind(packet), event.size);
+        arena.processPacket(event.peer, std::move(packet));
+        break;
+      }
+
+      // Clients that haven't joined can only ask to.
+      if (packet.type != sky::ClientPacket::Type::ReqJoin) break;
+      if (packet.arena.get() >= arenas.size()) {
+        appLog("Client asked to join a nonexistent arena!",
+               LogOrigin::Server);
+        break;
+      }
+      ServerArena &arena = *arenas[packet.arena.get()];
+      routes[event.peer] = &arena;
+      arena.join(event.peer, packet);
+      break;
+    }
+  }
+}
 
-  shared.logEvent(ServerEvent::Start(port, arenaInit.name));
+void ServerExec::processEvents() {
+  network.receive([&](tg::NetworkEvent<sky::ClientPacket> &&event) {
+    processEvent(std::move(event));
+  });
+}
+
+void ServerExec::tick(const TimeDiff delta) {
+  // Arenas tick in parallel, queueing what they send.
+  for (auto &arena : arenas) {
+    ServerArena *const ticked = arena.get();
+    workers.run([ticked, delta]() { ticked->tick(delta); });
+  }
+  workers.wait();
+
+  // Everything we sent this tick goes out now, as few datagrams as possible.
+  for (auto &arena : arenas) network.send(arena->shared.outbox.take());
+
+  // Loop timing and compression reports, when there's something to say.
+  if (loopStatsSchedule.tick(delta)) {
+    if (loopStats.missedDeadlines > 0 or loopStats.overruns > 0)
+      appLog("Server loop: " + loopStats.print(), LogOrigin::Server);
+    loopStats.reset();
+
+    tg::CompressionStats compressionStats;
+    for (auto &arena : arenas) {
+      auto &stats = arena->telegraph.compression.stats;
+      compressionStats.merge(stats);
+      stats.reset();
+    }
+    if (compressionStats.frames > 0)
+      appLog("Compression: " + compressionStats.print(), LogOrigin::Server);
+
+    loopStatsSchedule.reset();
+  }
+}
+
+void ServerExec::timedTick(const TimeDiff delta) {
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  tick(delta);
+  loopStats.recordTick(
+      std::chrono::duration<TimeDiff>(Clock::now() - start).count());
+}
+
+ServerExec::ServerExec(
+    const Port port,
+    const std::vector<sky::ArenaInit> &arenaInits,
+    const MakeServer &mkServer,
+    const size_t threads,
+    const unsigned int tickRate) :
+    ServerExec(std::make_unique<tg::ENetTransport>(tg::HostType::Server, port),
+               arenaInits, mkServer, threads, tickRate) { }
+
+ServerExec::ServerExec(
+    std::unique_ptr<tg::Transport> &&transport,
+    const std::vector<sky::ArenaInit> &arenaInits,
+    const MakeServer &mkServer,
+    const size_t threads,
+    const unsigned int tickRate) :
+    network(std::move(transport)),
+    // Catch up on at most a tenth of a second at once.
+    timestep(1.0f / TimeDiff(tickRate), std::max<size_t>(1, tickRate / 10)),
+    loopStats(timestep.interval),
+    loopStatsSchedule(30),
+    encoders(threads),
+    workers(std::min(threads ? threads : std::thread::hardware_concurrency(),
+                     std::max<size_t>(1, arenaInits.size()))),
+    running(true) {
+  for (size_t i = 0; i < arenaInits.size(); i++) {
+    arenas.push_back(std::make_unique<ServerArena>(
+        sky::ArenaID(i), network.getHost(), loopStats, arenaInits[i],
+        mkServer, encoders));
+  }
+}
+
+void ServerExec::step(const TimeDiff delta) {
+  network.pump(delta);
+  processEvents();
+  timedTick(delta);
+  network.pump(0); // send what we just queued
 }
 
 void ServerExec::run() {
-  sf::Clock clock;
+  using Clock = std::chrono::steady_clock;
+  auto lastPoll = Clock::now();
+  network.start();
+
   while (running) {
-    while (!poll()) { }
-    tick(clock.restart().asSeconds());
+    // Handle messages as they come in, until the next tick is due.
+    processEvents();
+    const auto now = Clock::now();
+    const size_t due = timestep.advance(
+        std::chrono::duration<Time>(now - lastPoll).count());
+    lastPoll = now;
+    if (due == 0) {
+      network.wait(now + std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<Time>(timestep.untilNext())));
+      continue;
+    }
 
-    sf::sleep(sf::milliseconds(16));
+    const TimeDiff lateness = TimeDiff(timestep.lateness);
+    loopStats.lateness.push(lateness);
+    loopStats.maxLateness = std::max(loopStats.maxLateness, lateness);
+    loopStats.missedDeadlines += due - 1;
+    loopStats.droppedTicks += timestep.dropped;
+
+    for (size_t i = 0; i < due; i++) {
+      if (i > 0) processEvents();
+      timedTick(timestep.interval);
+    }
   }
+
+  network.stop();
 }
@@ -19,14 +19,18 @@
  * Common abstraction for our multiplayer servers.
  */
 #pragma once
+#include <chrono>
 #include "servershared.hpp"
 #include "server/engine/skyinputcache.hpp"
+#include "server/engine/skybroadcaster.hpp"
+#include "util/threads.hpp"
+#include "util/networkthread.hpp"
 
 /**
  * Type-erasure for Server, representing the uniform API.
  */
 class ServerListener: public sky::SubsystemListener {
-  friend class ServerExec;
+  friend class ServerArena;
  protected:
   virtual void onPacket(ENetPeer *const client,
                         sky::Player &player,
@@ -69,24 +73,25 @@ class ServerLogger: public sky::ArenaLogger {
 
 };
 
+using MakeServer =
+std::function<std::unique_ptr<ServerListener>(ServerShared &)>;
+
 /**
- * Basic executor for a server. Implements the server-side multiplayer protocol.
+ * One arena of a ServerExec: its engine state, the Server running it, and
+ * the subsystems keeping its clients in sync. Arenas share nothing mutable;
+ * while ticking they only read from the Host and queue packets in their own
+ * Outbox, so they can tick in parallel.
  */
-class ServerExec {
-  friend struct ServerShared;
-
+class ServerArena {
+  friend class ServerExec;
  private:
-  tg::UsageFlag flag; // for enet global state
-
-  // Networking state.
-  tg::Host host;
-  tg::Telegraph<sky::ClientPacket> telegraph;
+  const sky::ArenaID id;
+  tg::Telegraph<sky::ClientPacket> telegraph; // encodes for this arena's clients
   ServerShared shared;
   sky::SkyInputManager inputManager;
 
   // Packet scheduling.
-  Scheduler skyDeltaSchedule,
-      scoreDeltaSchedule,
+  Scheduler scoreDeltaSchedule,
       pingSchedule,
       latencyUpdateSchedule;
 
@@ -96,19 +101,71 @@ class ServerExec {
   // Subsystems.
   ServerLogger logger;
   LatencyTracker latencyTracker;
+  SkyBroadcaster skyBroadcaster;
+
+  // Called from ServerExec, outside of ticks.
+  void join(ENetPeer *client, const sky::ClientPacket &packet);
+  void processPacket(ENetPeer *client, sky::ClientPacket &&packet);
+  void disconnect(ENetPeer *client);
+
+  // Called from a worker.
+  void tick(const TimeDiff delta);
+
+ public:
+  ServerArena(const sky::ArenaID id,
+              const tg::Host &host,
+              const LoopStats &loopStats,
+              const sky::ArenaInit &arenaInit,
+              const MakeServer &mkServer,
+              ThreadPool &encoders);
+};
+
+/**
+ * Basic executor for a server. Implements the server-side multiplayer
+ * protocol for any number of arenas behind one Host. Clients pick their
+ * arena in ReqJoin; arenas tick on a thread pool. In real time, the host
+ * lives on a network thread that decodes incoming packets and flushes
+ * outgoing ones, so the game thread only sees ready messages.
+ */
+class ServerExec {
+ private:
+  tg::UsageFlag flag; // for enet global state
+
+  // Networking state.
+  tg::NetworkThread<sky::ClientPacket> network;
+  std::map<ENetPeer *, ServerArena *> routes; // clients in an arena
+
+  // Loop timing. The simulation only ever steps by the fixed interval, so
+  // it comes out the same however the scheduler treats us.
+  FixedTimestep timestep;
+  LoopStats loopStats;
+  Scheduler loopStatsSchedule;
+
+  // Arenas, the workers ticking them, and those encoding their sky deltas.
+  ThreadPool encoders;
+  std::vector<std::unique_ptr<ServerArena>> arenas;
+  ThreadPool workers;
 
   // Application loop subroutines.
-  void processPacket(ENetPeer *client, const sky::ClientPacket &packet);
-  bool poll(); // (returns true when the queue has been exhausted)
+  void processEvent(tg::NetworkEvent<sky::ClientPacket> &&event);
+  void processEvents();
   void tick(const TimeDiff delta);
+  void timedTick(const TimeDiff delta);
 
  public:
   ServerExec(const Port port,
-             const sky::ArenaInit &arenaInit,
-             std::function<std::unique_ptr<ServerListener>(
-                 ServerShared &)> mkServer);
-
-  void run();
+             const std::vector<sky::ArenaInit> &arenaInits,
+             const MakeServer &mkServer,
+             const size_t threads = 0,
+             const unsigned int tickRate = 60);
+  ServerExec(std::unique_ptr<tg::Transport> &&transport,
+             const std::vector<sky::ArenaInit> &arenaInits,
+             const MakeServer &mkServer,
+             const size_t threads = 0, // (0: one per hardware thread)
+             const unsigned int tickRate = 60); // ticks per second
+
+  void run(); // in real time, until `running` is cleared
+  void step(const TimeDiff delta); // handle all events and tick once
 
   bool running;
 };
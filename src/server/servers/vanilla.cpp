@@ -97,6 +97,44 @@ void VanillaServer::onPacket(ENetPeer *const client,
         return;
       }
 
+      if (command[0] == "loopstats") {
+        if (command.size() > 1) {
+          shared.rconResponse(client, "/loopstats -- Prints server loop timing.");
+          return;
+        }
+        shared.rconResponse(client, shared.loopStats.print() + "\n"
+            + shared.encodingStats.print());
+        return;
+      }
+
+      if (command[0] == "netstats") {
+        if (command.size() > 2) {
+          shared.rconResponse(client, "/netstats [reset] -- Prints network telemetry.");
+          return;
+        }
+        if (command.size() == 2) {
+          if (command[1] != "reset") {
+            shared.rconResponse(client, "/netstats [reset] -- Prints network telemetry.");
+            return;
+          }
+          shared.telegraph.traffic.reset();
+          shared.rconResponse(client, "traffic stats reset");
+          return;
+        }
+
+        StringPrinter p;
+        for (const auto peer : shared.clients) {
+          const sky::Player *peerPlayer = shared.playerFromPeer(peer);
+          const auto stats = shared.host.peerStats(peer);
+          if (!peerPlayer or !stats) continue;
+          p.print(peerPlayer->getNickname() + ": ");
+          p.printLn(stats.get());
+        }
+        shared.telegraph.traffic.print(p);
+        shared.rconResponse(client, p.getString());
+        return;
+      }
+
       if (command[0] == "map") {
         if (command.size() < 2) {
           shared.rconResponse(client, "/map <name> -- Sets <name> as the next map.");
@@ -17,19 +17,75 @@
  */
 #include "servershared.hpp"
 
+/**
+ * LoopStats.
+ */
+
+LoopStats::LoopStats(const TimeDiff tickInterval) :
+    tickInterval(tickInterval),
+    lateness(60),
+    tickTime(60) {
+  reset();
+}
+
+void LoopStats::recordTick(const TimeDiff duration) {
+  ticks++;
+  tickTime.push(duration);
+  maxTickTime = std::max(maxTickTime, duration);
+  if (duration > tickInterval) overruns++;
+}
+
+void LoopStats::reset() {
+  ticks = 0;
+  missedDeadlines = 0;
+  overruns = 0;
+  droppedTicks = 0;
+  maxLateness = 0;
+  maxTickTime = 0;
+}
+
+std::string LoopStats::print() const {
+  const int load = int(100 * tickTime.mean<TimeDiff>() / tickInterval);
+  return std::to_string(missedDeadlines) + " of " + std::to_string(ticks)
+      + " ticks missed their deadline, " + std::to_string(overruns)
+      + " overran, " + std::to_string(droppedTicks) + " dropped; lateness "
+      + TimeStats(lateness).print()
+      + ", worst " + printTimeDiff(maxLateness)
+      + "; tick time " + TimeStats(tickTime).print()
+      + ", worst " + printTimeDiff(maxTickTime)
+      + ", " + std::to_string(load) + "% of budget";
+}
+
+/**
+ * EncodingStats.
+ */
+
+EncodingStats::EncodingStats() :
+    batches(0),
+    stalls(0),
+    latency(60) { }
+
+std::string EncodingStats::print() const {
+  return std::to_string(stalls) + " of " + std::to_string(batches)
+      + " sky delta batches stalled; pipeline latency "
+      + TimeStats(latency).print();
+}
+
 /**
  * ServerShared.
  */
 
 ServerShared::ServerShared(
-    tg::Host &host, tg::Telegraph<sky::ClientPacket> &telegraph,
-    const sky::ArenaInit &arenaInit) :
+    const tg::Host &host, tg::Telegraph<sky::ClientPacket> &telegraph,
+    const LoopStats &loopStats, const sky::ArenaInit &arenaInit) :
     arena(arenaInit), // initialize engine state
     skyHandle(arena, {}),
     scoreboard(arena, {}),
+    lagCompensator(arena, skyHandle),
 
     host(host),
-    telegraph(telegraph) { }
+    telegraph(telegraph),
+    loopStats(loopStats) { }
 
 sky::Player *ServerShared::playerFromPeer(ENetPeer *peer) const {
   if (peer->data) return (sky::Player *) peer->data;
@@ -51,21 +107,21 @@ void ServerShared::registerGameEnd() {
 }
 
 void ServerShared::sendToClients(const sky::ServerPacket &packet) {
-  telegraph.transmit(
-      host,
+  telegraph.post(
+      outbox,
       [&](
           std::function<void(ENetPeer *const)> transmit) {
-        for (auto const peer : host.getPeers()) { transmit(peer); }
+        for (auto const peer : clients) { transmit(peer); }
       }, packet);
 }
 
 void ServerShared::sendToClientsExcept(const PID pid,
                                        const sky::ServerPacket &packet) {
-  telegraph.transmit(
-      host,
+  telegraph.post(
+      outbox,
       [&](
           std::function<void(ENetPeer *const)> transmit) {
-        for (auto const peer : host.getPeers()) {
+        for (auto const peer : clients) {
           if (sky::Player *player = playerFromPeer(peer)) {
             if (player->pid != pid) transmit(peer);
           }
@@ -73,9 +129,19 @@ void ServerShared::sendToClientsExcept(const PID pid,
       }, packet);
 }
 
+void ServerShared::sendToClients(const std::vector<ENetPeer *> &clients,
+                                 const sky::ServerPacket &packet) {
+  telegraph.post(
+      outbox,
+      [&](
+          std::function<void(ENetPeer *const)> transmit) {
+        for (auto const peer : clients) transmit(peer);
+      }, packet);
+}
+
 void ServerShared::sendToClient(ENetPeer *const client,
                                 const sky::ServerPacket &packet) {
-  telegraph.transmit(host, client, packet);
+  telegraph.post(outbox, client, packet);
 }
 
 void ServerShared::rconResponse(ENetPeer *const client,
@@ -22,25 +22,66 @@
 #include "engine/arena.hpp"
 #include "util/telegraph.hpp"
 #include "server/engine/latencytracker.hpp"
+#include "server/engine/lagcompensator.hpp"
 #include "engine/protocol.hpp"
 #include "engine/event.hpp"
 
+/**
+ * Timing of the server loop against its tick deadlines.
+ */
+struct LoopStats {
+  LoopStats(const TimeDiff tickInterval);
+
+  const TimeDiff tickInterval; // each tick's budget
+
+  // Since the last report.
+  size_t ticks;
+  size_t missedDeadlines; // ran back-to-back, catching up
+  size_t overruns; // took longer than their budget
+  size_t droppedTicks; // given up on, past the catch-up limit
+  RollingSampler<TimeDiff> lateness; // how late ticks started
+  RollingSampler<TimeDiff> tickTime; // how long ticks took
+  TimeDiff maxLateness, maxTickTime;
+
+  void recordTick(const TimeDiff duration);
+
+  void reset();
+  std::string print() const;
+};
+
+/**
+ * Sky deltas encoded on workers, a tick behind the simulation.
+ */
+struct EncodingStats {
+  EncodingStats();
+
+  size_t batches, stalls; // stalls: we had to wait for the workers
+  RollingSampler<TimeDiff> latency; // from capturing a delta to sending it
+
+  std::string print() const;
+};
+
 /**
  * Shared object for the server, holding engine state and network
  * / logging methods.
  */
 struct ServerShared {
-  ServerShared(tg::Host &host, tg::Telegraph<sky::ClientPacket> &telegraph,
-               const sky::ArenaInit &arenaInit);
+  ServerShared(const tg::Host &host, tg::Telegraph<sky::ClientPacket> &telegraph,
+               const LoopStats &loopStats, const sky::ArenaInit &arenaInit);
 
   // Engine state.
   sky::Arena arena;
   sky::SkyHandle skyHandle;
   sky::Scoreboard scoreboard;
+  LagCompensator lagCompensator; // for judging hits as clients saw them
 
   // Network state.
-  tg::Host &host;
+  const tg::Host &host; // serviced on the network thread, for telemetry
   tg::Telegraph<sky::ClientPacket> &telegraph;
+  tg::Outbox outbox; // handed to the network thread at the end of every tick
+  std::vector<ENetPeer *> clients; // peers that joined this arena
+  const LoopStats &loopStats; // kept up by ServerExec, for all arenas
+  EncodingStats encodingStats;
   sky::Player *playerFromPeer(ENetPeer *peer) const;
 
   // Centralized state modification / synchronization.
@@ -52,6 +93,8 @@ struct ServerShared {
   void sendToClients(const sky::ServerPacket &packet);
   void sendToClientsExcept(const PID pid,
                            const sky::ServerPacket &packet);
+  void sendToClients(const std::vector<ENetPeer *> &clients,
+                     const sky::ServerPacket &packet);
   void sendToClient(ENetPeer *const client,
                     const sky::ServerPacket &packet);
 
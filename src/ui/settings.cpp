@@ -51,6 +51,7 @@ void serialize(Archive &ar, Settings &settings) {
   ar(cereal::make_nvp("enableDebug", settings.enableDebug),
      cereal::make_nvp("fullscreen", settings.fullscreen),
      cereal::make_nvp("resolution", settings.resolution),
+     cereal::make_nvp("interpolationDelay", settings.interpolationDelay),
      cereal::make_nvp("nickname", settings.nickname),
      cereal::make_nvp("bindings", settings.bindings));
 }
@@ -131,6 +132,7 @@ Settings::Settings(const std::string &filepath) :
     fullscreen(false),
     resolution(1600, 900),
     enableDebug(false),
+    interpolationDelay(0.1),
     nickname("nameless plane") {
   appLog("Loading client settings from " + inQuotes(filepath), LogOrigin::Client);
 
@@ -180,6 +182,8 @@ SettingsDelta::SettingsDelta(const Settings &oldSettings,
     nickname = newSettings.nickname;
   if (oldSettings.enableDebug != newSettings.enableDebug)
     enableDebug = newSettings.enableDebug;
+  if (oldSettings.interpolationDelay != newSettings.interpolationDelay)
+    interpolationDelay = newSettings.interpolationDelay;
   bindings = newSettings.bindings;
 }
 
@@ -187,6 +191,7 @@ void SettingsDelta::apply(Settings &settings) const {
   if (fullscreen) settings.fullscreen = *fullscreen;
   if (nickname) settings.nickname = *nickname;
   if (enableDebug) settings.enableDebug = *enableDebug;
+  if (interpolationDelay) settings.interpolationDelay = *interpolationDelay;
   if (bindings) settings.bindings = *bindings;
 }
 
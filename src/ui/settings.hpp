@@ -72,6 +72,7 @@ struct Settings {
 
   // Client settings.
   bool enableDebug;
+  float interpolationDelay; // how far behind the server remote planes render
   std::string nickname;
   ActionBindings bindings;
 
@@ -90,6 +91,7 @@ struct SettingsDelta {
 
   optional<bool> fullscreen;
   optional<bool> enableDebug;
+  optional<float> interpolationDelay;
   optional<std::string> nickname;
   optional<ActionBindings> bindings;
 };
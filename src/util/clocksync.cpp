@@ -0,0 +1,129 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+#include "clocksync.hpp"
+
+/**
+ * ClockSync.
+ */
+
+void ClockSync::push(const Sample &sample) {
+  samples.push_back(sample);
+  if (samples.size() > window) samples.pop_front();
+  refit();
+}
+
+void ClockSync::refit() {
+  std::vector<Sample> trusted(samples.begin(), samples.end());
+  std::sort(trusted.begin(), trusted.end(),
+            [](const Sample &x, const Sample &y) { return x.delay < y.delay; });
+  medianDelay = trusted[trusted.size() / 2].delay;
+  trusted.resize(std::min(trusted.size(), filter));
+
+  // Least squares through the trusted samples, around their mean time.
+  reference = 0;
+  baseOffset = 0;
+  for (const auto &sample : trusted) {
+    reference += sample.local;
+    baseOffset += sample.offset;
+  }
+  reference /= trusted.size();
+  baseOffset /= trusted.size();
+
+  double covariance = 0, variance = 0;
+  for (const auto &sample : trusted) {
+    covariance += (sample.local - reference) * (sample.offset - baseOffset);
+    variance += (sample.local - reference) * (sample.local - reference);
+  }
+  // Clocks that drift more than a percent apart are noise, not drift.
+  drift = variance > 1e-9 ? clamp(-0.01, 0.01, covariance / variance) : 0;
+
+  double residuals = 0;
+  TimeDiff bound = trusted.front().bound;
+  for (const auto &sample : trusted) {
+    const double residual =
+        sample.offset - (baseOffset + drift * (sample.local - reference));
+    residuals += residual * residual;
+    bound = std::min(bound, sample.bound);
+  }
+  fitError = bound + TimeDiff(std::sqrt(residuals / trusted.size()));
+
+  // Jitter is over all samples: it's what a jitter buffer has to absorb.
+  double meanDelay = 0, deviations = 0;
+  for (const auto &sample : samples) meanDelay += sample.delay;
+  meanDelay /= samples.size();
+  for (const auto &sample : samples)
+    deviations += (sample.delay - meanDelay) * (sample.delay - meanDelay);
+  delayJitter = TimeDiff(std::sqrt(deviations / samples.size()));
+}
+
+ClockSync::ClockSync(const size_t window, const size_t filter) :
+    reference(0),
+    baseOffset(0),
+    drift(0),
+    fitError(0),
+    delayJitter(0),
+    medianDelay(0),
+    window(window),
+    filter(filter) { }
+
+void ClockSync::registerExchange(const Time sent, const Time remote,
+                                 const Time received) {
+  const TimeDiff roundTrip = TimeDiff(received - sent);
+  const Time midpoint = (sent + received) / 2;
+  push({midpoint, remote - midpoint, roundTrip, roundTrip / 2});
+}
+
+void ClockSync::registerArrival(const Time remote, const Time received) {
+  push({received, remote - received, TimeDiff(received - remote), 0});
+}
+
+void ClockSync::reset() {
+  samples.clear();
+  reference = 0;
+  baseOffset = 0;
+  drift = 0;
+  fitError = 0;
+  delayJitter = 0;
+  medianDelay = 0;
+}
+
+bool ClockSync::ready() const {
+  return !samples.empty();
+}
+
+Time ClockSync::offset(const Time local) const {
+  return baseOffset + drift * (local - reference);
+}
+
+double ClockSync::skew() const {
+  return drift;
+}
+
+TimeDiff ClockSync::error() const {
+  return fitError;
+}
+
+TimeDiff ClockSync::jitter() const {
+  return delayJitter;
+}
+
+TimeDiff ClockSync::roundTrip() const {
+  return medianDelay;
+}
@@ -0,0 +1,72 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Estimating a remote clock against ours, NTP-style.
+ */
+#pragma once
+#include <deque>
+#include "util/types.hpp"
+
+/**
+ * Offset and drift of a remote clock against ours, from timestamped
+ * samples. Queueing only ever delays a sample, so of the recent ones we trust
+ * those that were delayed least, and fit a line through them: its value is
+ * the offset, its slope the skew.
+ *
+ * Samples are either round trips, whose offset is known to within half the
+ * round trip, or one-way arrivals, whose offset includes the (unknown)
+ * transit time. The latter still give a baseline for jitter buffers.
+ */
+class ClockSync {
+ private:
+  struct Sample {
+    Time local; // when it was taken, by our clock
+    Time offset; // remote clock minus ours
+    TimeDiff delay; // how long it spent on the way, relatively
+    TimeDiff bound; // how wrong its offset can be with no queueing
+  };
+
+  std::deque<Sample> samples;
+
+  // Fit through the least delayed samples, refreshed with each new one.
+  Time reference, baseOffset;
+  double drift;
+  TimeDiff fitError, delayJitter, medianDelay;
+
+  void push(const Sample &sample);
+  void refit();
+
+ public:
+  ClockSync(const size_t window = 32, const size_t filter = 8);
+
+  const size_t window; // how many recent samples we look at
+  const size_t filter; // how many of them we trust
+
+  void registerExchange(const Time sent, const Time remote,
+                        const Time received);
+  void registerArrival(const Time remote, const Time received);
+  void reset();
+
+  bool ready() const;
+  Time offset(const Time local) const; // remote clock minus ours, at `local`
+  double skew() const; // remote seconds per local second, minus one
+  TimeDiff error() const; // confidence bound on offset()
+  TimeDiff jitter() const; // standard deviation of the delays
+  TimeDiff roundTrip() const; // median delay, for round trips
+
+};
@@ -0,0 +1,145 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include "compression.hpp"
+
+namespace {
+
+const size_t minMatch = 4;
+const size_t maxOffset = 65535;
+const size_t hashBits = 12;
+
+uint32_t read32(const unsigned char *p) {
+  uint32_t x;
+  std::memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+size_t hashOf(const uint32_t x) {
+  return (x * 2654435761u) >> (32 - hashBits);
+}
+
+void writeLength(std::vector<unsigned char> &output, size_t length) {
+  while (length >= 255) {
+    output.push_back(255);
+    length -= 255;
+  }
+  output.push_back((unsigned char) length);
+}
+
+bool readLength(const unsigned char *data, const size_t size,
+                size_t &offset, size_t &length) {
+  unsigned char byte;
+  do {
+    if (offset >= size) return false;
+    byte = data[offset++];
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+void writeSequence(std::vector<unsigned char> &output,
+                   const unsigned char *literals, const size_t literalLength,
+                   const size_t matchOffset, const size_t matchLength) {
+  const size_t matchCode = matchLength ? matchLength - minMatch : 0;
+  output.push_back((unsigned char)
+                       ((std::min<size_t>(literalLength, 15) << 4)
+                           | std::min<size_t>(matchCode, 15)));
+  if (literalLength >= 15) writeLength(output, literalLength - 15);
+  output.insert(output.end(), literals, literals + literalLength);
+
+  if (matchLength) {
+    output.push_back((unsigned char) (matchOffset & 0xff));
+    output.push_back((unsigned char) (matchOffset >> 8));
+    if (matchCode >= 15) writeLength(output, matchCode - 15);
+  }
+}
+
+}
+
+void lzCompress(const unsigned char *data, const size_t size,
+                std::vector<unsigned char> &output) {
+  std::array<size_t, 1 << hashBits> table;
+  table.fill(size); // invalid position
+
+  size_t anchor = 0, i = 0;
+  while (i + minMatch <= size) {
+    const uint32_t sequence = read32(data + i);
+    size_t &entry = table[hashOf(sequence)];
+    const size_t candidate = entry;
+    entry = i;
+
+    if (candidate < i and i - candidate <= maxOffset
+        and read32(data + candidate) == sequence) {
+      size_t length = minMatch;
+      while (i + length < size and data[candidate + length] == data[i + length])
+        ++length;
+
+      writeSequence(output, data + anchor, i - anchor, i - candidate, length);
+      i += length;
+      anchor = i;
+    } else {
+      ++i;
+    }
+  }
+
+  // The block ends with a literal run and no back-reference.
+  writeSequence(output, data + anchor, size - anchor, 0, 0);
+}
+
+bool lzDecompress(const unsigned char *data, const size_t size,
+                  const size_t decompressedSize,
+                  std::vector<unsigned char> &output) {
+  output.resize(decompressedSize);
+  size_t in = 0, out = 0;
+
+  while (in < size) {
+    const unsigned char token = data[in++];
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 and !readLength(data, size, in, literalLength))
+      return false;
+    if (literalLength > size - in or literalLength > decompressedSize - out)
+      return false;
+    std::copy(data + in, data + in + literalLength, output.begin() + out);
+    in += literalLength;
+    out += literalLength;
+
+    if (in == size) break; // last sequence
+
+    if (size - in < 2) return false;
+    const size_t matchOffset = data[in] | (size_t(data[in + 1]) << 8);
+    in += 2;
+    size_t matchLength = token & 0x0f;
+    if (matchLength == 15 and !readLength(data, size, in, matchLength))
+      return false;
+    matchLength += minMatch;
+
+    if (matchOffset == 0 or matchOffset > out
+        or matchLength > decompressedSize - out)
+      return false;
+    // Byte by byte: references can overlap what they produce.
+    for (size_t j = 0; j < matchLength; ++j, ++out)
+      output[out] = output[out - matchOffset];
+  }
+
+  return out == decompressedSize;
+}
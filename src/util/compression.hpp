@@ -0,0 +1,38 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * A small LZ77-family codec, for compressing large network payloads.
+ */
+#pragma once
+#include <vector>
+#include <cstddef>
+
+/**
+ * Compress a block of memory, appending the result to `output`. The format
+ * is a sequence of (literal run, back-reference) pairs, like LZ4's blocks.
+ */
+void lzCompress(const unsigned char *data, const size_t size,
+                std::vector<unsigned char> &output);
+
+/**
+ * Decompress a block produced by lzCompress into `output`, which is resized
+ * to `decompressedSize`. Returns false if the block is malformed.
+ */
+bool lzDecompress(const unsigned char *data, const size_t size,
+                  const size_t decompressedSize,
+                  std::vector<unsigned char> &output);
@@ -0,0 +1,239 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "loopback.hpp"
+
+namespace tg {
+
+/**
+ * LoopbackNetwork.
+ */
+
+void LoopbackNetwork::post(LoopbackTransport &destination,
+                           const ENetEvent &event) {
+  deliveries.push_back({now + latency, &destination, event});
+}
+
+void LoopbackNetwork::deliver() {
+  while (!deliveries.empty() and deliveries.front().time <= now) {
+    const Delivery &delivery = deliveries.front();
+    if (delivery.event.type == ENET_EVENT_TYPE_RECEIVE)
+      delivery.destination->receivedData += delivery.event.packet->dataLength;
+    delivery.destination->events.push_back(delivery.event);
+    deliveries.pop_front();
+  }
+}
+
+LoopbackNetwork::LoopbackNetwork(const TimeDiff latency) :
+    nextPort(49152),
+    now(0),
+    latency(latency) { }
+
+LoopbackNetwork::~LoopbackNetwork() {
+  assert(transports.empty()); // they hold a reference to us
+}
+
+void LoopbackNetwork::advance(const TimeDiff delta) {
+  now += delta;
+}
+
+Time LoopbackNetwork::getTime() const {
+  return now;
+}
+
+/**
+ * LoopbackTransport.
+ */
+
+ENetPeer *LoopbackTransport::createPeer(const Port remotePort) {
+  ENetPeer *peer;
+  if (freePeers.empty()) {
+    peers.emplace_back(new ENetPeer());
+    peer = peers.back().get();
+  } else {
+    peer = freePeers.back();
+    freePeers.pop_back();
+    *peer = ENetPeer();
+  }
+  peer->address.host = 0x0100007f; // 127.0.0.1, in network order
+  peer->address.port = remotePort;
+  peer->mtu = ENET_HOST_DEFAULT_MTU;
+  peer->packetThrottle = ENET_PEER_PACKET_THROTTLE_SCALE;
+  peer->roundTripTime = peer->lowestRoundTripTime =
+      enet_uint32(2000 * network.latency);
+  links[peer] = Link{nullptr, nullptr, false};
+  return peer;
+}
+
+void LoopbackTransport::closeLink(ENetPeer *peer) {
+  Link &link = links.at(peer);
+  if (!link.connected) return;
+  link.connected = false;
+
+  ENetEvent event{};
+  event.type = ENET_EVENT_TYPE_DISCONNECT;
+  if (link.remote) {
+    // Either side may reuse its peer from now on.
+    Link &remoteLink = link.remote->links.at(link.remotePeer);
+    remoteLink.connected = false;
+    remoteLink.remote = nullptr;
+    event.peer = link.remotePeer;
+    network.post(*link.remote, event);
+    link.remote = nullptr;
+  }
+  event.peer = peer;
+  network.post(*this, event);
+}
+
+LoopbackTransport::LoopbackTransport(LoopbackNetwork &network,
+                                     const Port port) :
+    network(network),
+    port(port ? port : network.nextPort++),
+    receivedData(0),
+    sentData(0) {
+  if (network.transports.find(this->port) != network.transports.end())
+    throw std::runtime_error("Loopback port already in use!");
+  network.transports[this->port] = this;
+}
+
+LoopbackTransport::~LoopbackTransport() {
+  // Our peers see us disconnect, and forget about us.
+  for (auto &link : links) {
+    if (!link.second.remote) continue;
+    Link &remoteLink = link.second.remote->links.at(link.second.remotePeer);
+    remoteLink.remote = nullptr;
+    if (remoteLink.connected) {
+      remoteLink.connected = false;
+      ENetEvent event{};
+      event.type = ENET_EVENT_TYPE_DISCONNECT;
+      event.peer = link.second.remotePeer;
+      network.post(*link.second.remote, event);
+    }
+  }
+
+  // Dropping everything in flight to or from us.
+  for (const auto &send : outgoing) {
+    if (--send.packet->referenceCount == 0) enet_packet_destroy(send.packet);
+  }
+  auto &deliveries = network.deliveries;
+  for (auto iter = deliveries.begin(); iter != deliveries.end();) {
+    if (iter->destination == this) {
+      events.push_back(iter->event);
+      iter = deliveries.erase(iter);
+    } else ++iter;
+  }
+  for (const auto &event : events) {
+    if (event.type == ENET_EVENT_TYPE_RECEIVE)
+      enet_packet_destroy(event.packet);
+  }
+
+  network.transports.erase(port);
+}
+
+ENetPeer *LoopbackTransport::connect(const std::string &, const Port port) {
+  ENetPeer *peer = createPeer(port);
+
+  ENetEvent event{};
+  const auto remote = network.transports.find(port);
+  if (remote == network.transports.end()) {
+    // Nobody's listening, the connection fails.
+    event.type = ENET_EVENT_TYPE_DISCONNECT;
+    event.peer = peer;
+    network.post(*this, event);
+    return peer;
+  }
+
+  ENetPeer *remotePeer = remote->second->createPeer(this->port);
+  links[peer] = Link{remote->second, remotePeer, true};
+  remote->second->links[remotePeer] = Link{this, peer, true};
+
+  event.type = ENET_EVENT_TYPE_CONNECT;
+  event.peer = remotePeer;
+  network.post(*remote->second, event);
+  event.peer = peer;
+  network.post(*this, event);
+  return peer;
+}
+
+void LoopbackTransport::disconnect(ENetPeer *peer) {
+  closeLink(peer);
+}
+
+void LoopbackTransport::send(ENetPeer *peer, const enet_uint8 channel,
+                             ENetPacket *packet) {
+  if (!links.at(peer).connected) return;
+  packet->referenceCount++;
+  outgoing.push_back({peer, channel, packet});
+}
+
+int LoopbackTransport::service(ENetEvent &event, const enet_uint32) {
+  flush();
+  return checkEvents(event);
+}
+
+int LoopbackTransport::checkEvents(ENetEvent &event) {
+  network.deliver();
+  if (events.empty()) {
+    event.type = ENET_EVENT_TYPE_NONE;
+    return 0;
+  }
+
+  event = events.front();
+  events.pop_front();
+  if (event.type == ENET_EVENT_TYPE_CONNECT)
+    event.peer->state = ENET_PEER_STATE_CONNECTED;
+  if (event.type == ENET_EVENT_TYPE_DISCONNECT) {
+    event.peer->state = ENET_PEER_STATE_DISCONNECTED;
+    freePeers.push_back(event.peer);
+  }
+  return 1;
+}
+
+void LoopbackTransport::flush() {
+  for (const auto &send : outgoing) {
+    ENetPacket *packet = send.packet;
+
+    // The receiver gets its own copy, to destroy when it's done.
+    const Link &link = links.at(send.peer);
+    if (link.connected and link.remote) {
+      ENetEvent event{};
+      event.type = ENET_EVENT_TYPE_RECEIVE;
+      event.peer = link.remotePeer;
+      event.channelID = send.channel;
+      event.packet = enet_packet_create(
+          packet->data, packet->dataLength, packet->flags);
+      sentData += packet->dataLength;
+      network.post(*link.remote, event);
+    }
+
+    if (--packet->referenceCount == 0) enet_packet_destroy(packet);
+  }
+  outgoing.clear();
+}
+
+Port LoopbackTransport::getPort() const {
+  return port;
+}
+
+void LoopbackTransport::takeDataTotals(size_t &received, size_t &sent) {
+  received = receivedData;
+  sent = sentData;
+  receivedData = 0;
+  sentData = 0;
+}
+
+}
@@ -0,0 +1,111 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * In-memory transport, for running clients and servers in one process.
+ */
+#pragma once
+#include <deque>
+#include "telegraph.hpp"
+
+namespace tg {
+
+class LoopbackTransport;
+
+/**
+ * The wire between LoopbackTransports. Deliveries are lossless, in order,
+ * and take a fixed latency on a virtual clock that only moves when we
+ * advance it, so runs are deterministic and never touch the kernel.
+ */
+class LoopbackNetwork {
+  friend class LoopbackTransport;
+ private:
+  struct Delivery {
+    Time time;
+    LoopbackTransport *destination;
+    ENetEvent event;
+  };
+  std::deque<Delivery> deliveries; // in order of time
+  std::map<Port, LoopbackTransport *> transports;
+  Port nextPort; // for clients
+  Time now;
+
+  void post(LoopbackTransport &destination, const ENetEvent &event);
+  void deliver(); // hand out what's due
+
+ public:
+  LoopbackNetwork(const TimeDiff latency = 0);
+  LoopbackNetwork(const LoopbackNetwork &) = delete;
+  LoopbackNetwork &operator=(const LoopbackNetwork &) = delete;
+  ~LoopbackNetwork();
+
+  const TimeDiff latency; // one way
+
+  void advance(const TimeDiff delta);
+  Time getTime() const;
+};
+
+/**
+ * Transport over a LoopbackNetwork. Like ENet, it sends what was queued on
+ * flush() or service(), and reuses a peer for a new connection once its
+ * disconnection was polled; service() never blocks, since time only passes
+ * when the network is advanced.
+ */
+class LoopbackTransport: public Transport {
+  friend class LoopbackNetwork;
+ private:
+  struct Link {
+    LoopbackTransport *remote; // null once it's gone
+    ENetPeer *remotePeer;
+    bool connected;
+  };
+  struct Send {
+    ENetPeer *peer;
+    enet_uint8 channel;
+    ENetPacket *packet;
+  };
+
+  LoopbackNetwork &network;
+  const Port port;
+  std::vector<std::unique_ptr<ENetPeer>> peers;
+  std::vector<ENetPeer *> freePeers; // reused like ENet's slots
+  std::map<const ENetPeer *, Link> links;
+  std::vector<Send> outgoing;
+  std::deque<ENetEvent> events;
+  size_t receivedData, sentData;
+
+  ENetPeer *createPeer(const Port remotePort);
+  void closeLink(ENetPeer *peer);
+
+ public:
+  LoopbackTransport(LoopbackNetwork &network, const Port port = 0);
+  ~LoopbackTransport();
+
+  // Transport impl.
+  ENetPeer *connect(const std::string &address, const Port port) override;
+  void disconnect(ENetPeer *peer) override;
+  void send(ENetPeer *peer, const enet_uint8 channel,
+            ENetPacket *packet) override;
+  int service(ENetEvent &event, const enet_uint32 timeout) override;
+  int checkEvents(ENetEvent &event) override;
+  void flush() override;
+
+  Port getPort() const override;
+  void takeDataTotals(size_t &received, size_t &sent) override;
+};
+
+}
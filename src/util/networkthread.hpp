@@ -0,0 +1,277 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * A thread servicing a tg::Host, so network bursts don't eat into ticks.
+ */
+#pragma once
+#include <chrono>
+#include <deque>
+#include "telegraph.hpp"
+
+namespace tg {
+
+/**
+ * Something that happened on the network, as the game thread sees it:
+ * a peer connected or disconnected, or a message arrived.
+ */
+template<typename ReceiveType>
+struct NetworkEvent {
+  ENetEventType type;
+  ENetPeer *peer;
+  optional<ReceiveType> message; // for ENET_EVENT_TYPE_RECEIVE
+  size_t size; // of the message's frame
+};
+
+/**
+ * Owns a Host and does all the work that touches it: servicing it, decoding
+ * what comes in, and flushing Outboxes the game thread filled. The two sides
+ * talk through lock-free queues; the host's telemetry can be read from the
+ * game thread through getHost().
+ *
+ * Neither side polls. The game thread sleeps in wait() until an event comes
+ * in or its next tick is due; the network thread sleeps in the host's
+ * service until then, and after that until the game thread sends its batch.
+ *
+ * Without start(), nothing runs in the background and pump() does one pass
+ * of the work on the calling thread, for deterministic runs.
+ */
+template<typename ReceiveType>
+class NetworkThread {
+ private:
+  using Event = NetworkEvent<ReceiveType>;
+  using Clock = std::chrono::steady_clock;
+
+  struct Batch {
+    size_t seen; // events the game thread had taken when it sent this
+    Outbox outbox;
+  };
+
+  Host host;
+  Telegraph<ReceiveType> telegraph; // decoding only
+
+  SpscQueue<Event> incoming;
+  SpscQueue<Batch> outgoing;
+  std::deque<Event> backlog; // decoded, waiting for room in `incoming`
+
+  size_t delivered; // events handed to the game thread, network side
+  size_t taken; // events the game thread took, game side
+  // Where in the event stream peers disconnected, until the game thread has
+  // seen it. Batches it sent before then don't go to them: the host may
+  // already have reused the peer for a new connection.
+  std::map<ENetPeer *, size_t> disconnects;
+
+  std::thread thread;
+  std::atomic<bool> running;
+
+  // Wake-ups across the threads. The game thread waits for events; the
+  // network thread, once the game thread's next batch is due, for the batch.
+  std::mutex wakeMutex;
+  std::condition_variable eventsReady, batchReady;
+  bool eventsPending; // guarded by wakeMutex
+  bool networkWoken; // guarded by wakeMutex
+  std::atomic<Clock::time_point> nextBatch;
+
+  void signalEvents() {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      eventsPending = true;
+    }
+    eventsReady.notify_one();
+  }
+
+  void wakeNetwork() {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      networkWoken = true;
+    }
+    batchReady.notify_one();
+  }
+
+  // Returns false if the game thread isn't keeping up.
+  bool deliver(Event &&event) {
+    delivered++;
+    if (backlog.empty() and incoming.push(std::move(event))) return true;
+    backlog.push_back(std::move(event));
+    return false;
+  }
+
+  bool deliverBacklog() {
+    while (!backlog.empty()) {
+      if (!incoming.push(std::move(backlog.front()))) return false;
+      backlog.pop_front();
+    }
+    return true;
+  }
+
+  void handle(const ENetEvent &event) {
+    switch (event.type) {
+      case ENET_EVENT_TYPE_NONE:
+        break;
+      case ENET_EVENT_TYPE_CONNECT:
+      case ENET_EVENT_TYPE_DISCONNECT: {
+        if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+          disconnects[event.peer] = delivered;
+        deliver({event.type, event.peer, {}, 0});
+        break;
+      }
+      case ENET_EVENT_TYPE_RECEIVE: {
+        telegraph.receiveSized(
+            event.packet, [&](ReceiveType &&message, const size_t size) {
+              deliver({event.type, event.peer, std::move(message), size});
+            });
+        enet_packet_destroy(event.packet);
+        break;
+      }
+    }
+  }
+
+  void work() {
+    // How long we wait for a batch the game thread is late with before
+    // servicing the host again.
+    const std::chrono::milliseconds lateBatchTimeout(5);
+    auto lastPump = Clock::now();
+    while (running) {
+      // The host can't be woken up, so it's only serviced while the game
+      // thread isn't about to send anything; past that, we wait for the
+      // batch, and incoming packets wait in the socket.
+      const auto due = nextBatch.load();
+      if (due <= Clock::now()) {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        batchReady.wait_for(lock, lateBatchTimeout,
+                            [this]() { return networkWoken or !running; });
+        networkWoken = false;
+      }
+
+      // Round up, so we don't spin through the last millisecond.
+      const auto now = Clock::now();
+      enet_uint32 timeout = 0;
+      if (due > now) {
+        timeout = enet_uint32(std::chrono::duration_cast<
+            std::chrono::milliseconds>(due - now).count()) + 1;
+      }
+      pump(std::chrono::duration<TimeDiff>(now - lastPump).count(), timeout);
+      lastPump = now;
+    }
+  }
+
+ public:
+  NetworkThread(std::unique_ptr<Transport> &&transport,
+                const size_t queueSize = 4096) :
+      host(std::move(transport)),
+      incoming(queueSize),
+      outgoing(queueSize),
+      delivered(0),
+      taken(0),
+      running(false),
+      eventsPending(false),
+      networkWoken(false),
+      nextBatch(Clock::time_point()) { }
+  NetworkThread(const NetworkThread &) = delete;
+  NetworkThread &operator=(const NetworkThread &) = delete;
+  ~NetworkThread() { stop(); }
+
+  /**
+   * Network side. One pass: flush what the game thread sent, tick the host,
+   * then decode events until there are none left or the game thread falls
+   * behind. Waits at most `timeout` milliseconds for the first event.
+   */
+  void pump(const TimeDiff delta, const enet_uint32 timeout = 0) {
+    bool flushed = false;
+    while (auto batch = outgoing.pop()) {
+      for (auto peer = disconnects.begin(); peer != disconnects.end();) {
+        if (peer->second < batch->seen) {
+          peer = disconnects.erase(peer);
+        } else {
+          batch->outbox.drop(peer->first);
+          ++peer;
+        }
+      }
+      batch->outbox.flush(host);
+      flushed = true;
+    }
+    if (flushed) host.flush();
+
+    host.tick(delta);
+
+    const size_t pushed = delivered - backlog.size();
+    if (deliverBacklog()) {
+      for (ENetEvent event = host.poll(timeout);
+           event.type != ENET_EVENT_TYPE_NONE;
+           event = host.checkEvents()) {
+        handle(event);
+        if (!backlog.empty()) break;
+      }
+    }
+    if (delivered - backlog.size() != pushed) signalEvents();
+  }
+
+  void start() {
+    if (running) return;
+    running = true;
+    thread = std::thread([this]() { work(); });
+  }
+
+  void stop() {
+    running = false;
+    wakeNetwork();
+    if (thread.joinable()) thread.join();
+  }
+
+  /**
+   * Game side. Hand every event that came in so far to a callback, in order.
+   */
+  template<typename Callback>
+  void receive(Callback &&callback) {
+    while (auto event = incoming.pop()) {
+      taken++;
+      callback(std::move(*event));
+    }
+  }
+
+  /**
+   * Game side. Sleep until events came in or `until`, when the game thread
+   * next sends a batch; the network thread services the host until then.
+   */
+  void wait(const Clock::time_point until) {
+    nextBatch = until;
+    wakeNetwork();
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    eventsReady.wait_until(lock, until, [this]() { return eventsPending; });
+    eventsPending = false;
+  }
+
+  /**
+   * Game side. Queue an Outbox to be flushed to the host. Peers in it that
+   * disconnected before the game thread received the event are left out.
+   */
+  void send(Outbox &&outbox) {
+    Batch batch{taken, std::move(outbox)};
+    while (!outgoing.push(std::move(batch))) {
+      if (thread.joinable()) std::this_thread::yield();
+      else pump(0);
+    }
+    wakeNetwork();
+  }
+
+  const Host &getHost() const {
+    return host;
+  }
+};
+
+}
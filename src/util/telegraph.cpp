@@ -15,8 +15,10 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <chrono>
 #include "telegraph.hpp"
 #include "util/methods.hpp"
+#include "util/compression.hpp"
 
 namespace tg {
 
@@ -43,47 +45,513 @@ UsageFlag::~UsageFlag() {
 }
 
 /**
- * Host.
+ * Reliability.
  */
 
-void Host::registerPeer(ENetPeer *peer) {
-  auto found = std::find(peers.begin(), peers.end(), peer);
-  if (found != peers.end()) {
-    *found = peer;
+enet_uint8 channelOf(const Reliability reliability) {
+  return enet_uint8(reliability);
+}
+
+enet_uint32 packetFlagsOf(const Reliability reliability) {
+  // Without UNRELIABLE_FRAGMENT, ENet sends the fragments of unreliable
+  // packets bigger than the MTU reliably. It only looks at the flag for those,
+  // and packets can be shared between peers with different MTUs, so we set it
+  // on all of them.
+  switch (reliability) {
+    case Reliability::ReliableOrdered:
+      return ENET_PACKET_FLAG_RELIABLE;
+    case Reliability::UnreliableSequenced:
+      return ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+    case Reliability::Unsequenced:
+      return ENET_PACKET_FLAG_UNSEQUENCED
+          | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+  }
+  return ENET_PACKET_FLAG_RELIABLE;
+}
+
+/**
+ * SizeHistogram.
+ */
+
+constexpr size_t SizeHistogram::bucketCount;
+
+SizeHistogram::SizeHistogram() :
+    count(0), bytes(0), max(0) {
+  buckets.fill(0);
+}
+
+void SizeHistogram::record(const size_t size) {
+  size_t index = 0;
+  while (index < bucketCount - 1 and (size >> (index + 1)) != 0) index++;
+  buckets[index]++;
+  count++;
+  bytes += size;
+  max = std::max(max, size);
+}
+
+void SizeHistogram::merge(const SizeHistogram &other) {
+  for (size_t i = 0; i < bucketCount; i++) buckets[i] += other.buckets[i];
+  count += other.count;
+  bytes += other.bytes;
+  max = std::max(max, other.max);
+}
+
+size_t SizeHistogram::bucket(const size_t index) const {
+  return buckets.at(index);
+}
+
+void SizeHistogram::print(Printer &p) const {
+  if (count == 0) {
+    p.print("none");
+    return;
+  }
+  p.print(std::to_string(count) + " x " + std::to_string(bytes / count)
+              + "B avg, " + std::to_string(max) + "B max |");
+  for (size_t i = 0; i < bucketCount; i++) {
+    if (buckets[i] == 0) continue;
+    const std::string bound = (i == bucketCount - 1)
+                              ? ">=" + std::to_string(size_t(1) << i)
+                              : "<" + std::to_string(size_t(1) << (i + 1));
+    p.print(" " + bound + ":" + std::to_string(buckets[i]));
+  }
+}
+
+/**
+ * TrafficStats.
+ */
+
+void TrafficStats::recordSent(const std::string &kind, const size_t size) {
+  sent[kind].record(size);
+}
+
+void TrafficStats::recordReceived(const std::string &kind,
+                                  const size_t size) {
+  received[kind].record(size);
+}
+
+void TrafficStats::merge(const TrafficStats &other) {
+  for (const auto &entry : other.sent) sent[entry.first].merge(entry.second);
+  for (const auto &entry : other.received)
+    received[entry.first].merge(entry.second);
+}
+
+void TrafficStats::reset() {
+  sent.clear();
+  received.clear();
+}
+
+void TrafficStats::print(Printer &p) const {
+  const auto printTable = [&](const std::string &direction,
+                              const std::map<std::string, SizeHistogram> &table) {
+    for (const auto &entry : table) {
+      p.print(direction + " " + entry.first + ": ");
+      p.printLn(entry.second);
+    }
+  };
+  printTable("sent", sent);
+  printTable("received", received);
+}
+
+/**
+ * PeerStats.
+ */
+
+PeerStats::PeerStats() :
+    bytesSent(0), bytesReceived(0),
+    packetsSent(0), packetsReceived(0),
+    fragmentsSent(0), retransmits(0),
+    rtt(0), packetLoss(0) { }
+
+void PeerStats::print(Printer &p) const {
+  p.print("sent " + std::to_string(bytesSent) + "B in "
+              + std::to_string(packetsSent) + " packets ("
+              + std::to_string(fragmentsSent) + " fragments), received "
+              + std::to_string(bytesReceived) + "B in "
+              + std::to_string(packetsReceived) + " packets, "
+              + std::to_string(retransmits) + " retransmits, rtt "
+              + printTimeDiff(rtt) + ", loss "
+              + printFloat(100.0f * packetLoss) + "%");
+}
+
+/**
+ * LinkQuality.
+ */
+
+LinkQuality::LinkQuality(const ENetPeer *peer) :
+    rtt(TimeDiff(peer->roundTripTime) / 1000.0f),
+    packetLoss(float(peer->packetLoss) / ENET_PEER_PACKET_LOSS_SCALE),
+    throttle(float(peer->packetThrottle) / ENET_PEER_PACKET_THROTTLE_SCALE) { }
+
+LinkQuality::LinkQuality(const TimeDiff rtt, const float packetLoss,
+                         const float throttle) :
+    rtt(rtt), packetLoss(packetLoss), throttle(throttle) { }
+
+/**
+ * RateControl.
+ */
+
+RateControl::RateControl(const TimeDiff minInterval,
+                         const TimeDiff maxInterval,
+                         const TimeDiff initialInterval) :
+    minInterval(minInterval),
+    maxInterval(maxInterval),
+    interval(initialInterval),
+    elapsed(0) { }
+
+void RateControl::update(const LinkQuality &link, const float budgetUse) {
+  // The lowest RTT we've seen is the link's latency without queueing. Let it
+  // drift up slowly, in case the route changed.
+  if (!baseRtt or link.rtt < baseRtt.get()) baseRtt = link.rtt;
+  else baseRtt = baseRtt.get() + (link.rtt - baseRtt.get()) * 0.01f;
+
+  const bool congested = link.packetLoss > 0.02f
+      or link.throttle < 0.75f
+      or link.rtt > baseRtt.get() + 0.05f;
+
+  if (congested or budgetUse > 1) {
+    interval *= 1.5f * std::max(1.0f, budgetUse);
   } else {
-    peers.push_back(peer);
+    interval = 1.0f / ((1.0f / interval) + 5.0f);
   }
+  interval = clamp(minInterval, maxInterval, interval);
 }
 
-void Host::unregisterPeer(ENetPeer *peer) {
-  auto found = std::find(peers.begin(), peers.end(), peer);
-  if (found != peers.end()) {
-    peers.erase(found);
+void RateControl::tick(const TimeDiff delta) {
+  elapsed += delta;
+}
+
+bool RateControl::due() const {
+  return elapsed >= interval;
+}
+
+void RateControl::reset() {
+  // Keep the remainder so the average rate is right, but don't burst.
+  elapsed = std::min(std::max(0.0f, elapsed - interval), interval);
+}
+
+TimeDiff RateControl::getInterval() const {
+  return interval;
+}
+
+/**
+ * OutputBuffer.
+ */
+
+std::streamsize OutputBuffer::xsputn(const char *s, std::streamsize n) {
+  if (length + n > storage.size())
+    storage.resize(std::max(storage.size() * 2, length + size_t(n)));
+  std::copy(s, s + n, storage.data() + length);
+  length += n;
+  return n;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+  if (traits_type::eq_int_type(ch, traits_type::eof()))
+    return traits_type::not_eof(ch);
+  const char c = traits_type::to_char_type(ch);
+  xsputn(&c, 1);
+  return ch;
+}
+
+OutputBuffer::OutputBuffer() :
+    storage(256),
+    length(0) { }
+
+void OutputBuffer::clear() {
+  length = 0;
+}
+
+const char *OutputBuffer::data() const {
+  return storage.data();
+}
+
+size_t OutputBuffer::size() const {
+  return length;
+}
+
+/**
+ * InputBuffer.
+ */
+
+InputBuffer::InputBuffer(const unsigned char *data, const size_t size) {
+  char *begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+  setg(begin, begin, begin + size);
+}
+
+/**
+ * Framing.
+ */
+
+void writeVarint(std::vector<unsigned char> &buffer, size_t x) {
+  do {
+    unsigned char byte = x & 0x7f;
+    x >>= 7;
+    if (x) byte |= 0x80;
+    buffer.push_back(byte);
+  } while (x);
+}
+
+bool readVarint(const unsigned char *data, const size_t size,
+                size_t &offset, size_t &x) {
+  x = 0;
+  for (size_t shift = 0; offset < size and shift < 64; shift += 7) {
+    const unsigned char byte = data[offset++];
+    x |= size_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
   }
+  return false;
 }
 
-void Host::sampleBandwidth() {
-  lastIncomingBandwidth = float(host->totalReceivedData) / 1000.0f;
-  lastOutgoingBandwidth = float(host->totalSentData) / 1000.0f;
-  host->totalReceivedData = 0;
-  host->totalSentData = 0;
+void writeFrameHeader(std::vector<unsigned char> &buffer, const Frame &frame) {
+  writeVarint(buffer, (frame.size << 1) | size_t(frame.compressed));
 }
 
-Host::Host(const HostType type, const Port port) :
-    host(nullptr),
-    bandwidthSampler(1) {
+ENetPacket *createFramedPacket(const Frame &frame,
+                               const Reliability reliability) {
+  std::vector<unsigned char> header;
+  writeFrameHeader(header, frame);
+  ENetPacket *packet = enet_packet_create(
+      nullptr, header.size() + frame.size, packetFlagsOf(reliability));
+  std::copy(header.begin(), header.end(), packet->data);
+  std::copy(frame.data, frame.data + frame.size, packet->data + header.size());
+  return packet;
+}
+
+bool readFrameHeader(const unsigned char *data, const size_t size,
+                     size_t &offset, size_t &length, bool &compressed) {
+  size_t header;
+  if (!readVarint(data, size, offset, header)) return false;
+  length = header >> 1;
+  compressed = header & 1;
+  return length <= size - offset;
+}
+
+/**
+ * CompressionStats.
+ */
+
+CompressionStats::CompressionStats() {
+  reset();
+}
+
+void CompressionStats::merge(const CompressionStats &other) {
+  frames += other.frames;
+  bytesIn += other.bytesIn;
+  bytesOut += other.bytesOut;
+  time += other.time;
+}
+
+void CompressionStats::reset() {
+  frames = 0;
+  bytesIn = 0;
+  bytesOut = 0;
+  time = 0;
+}
+
+std::string CompressionStats::print() const {
+  if (frames == 0) return "nothing compressed";
+  return std::to_string(frames) + " frames, "
+      + std::to_string(bytesIn) + " -> " + std::to_string(bytesOut)
+      + " bytes (" + printFloat(100.0f * bytesOut / bytesIn) + "%), "
+      + printTimeDiff(time) + " spent";
+}
+
+/**
+ * FrameCompressor.
+ */
+
+// Compressed frames claiming more than this are rejected when inflating.
+static const size_t maxInflatedSize = 1 << 24;
+
+FrameCompressor::FrameCompressor() { }
+
+Frame FrameCompressor::compress(const OutputBuffer &buffer) {
+  const Frame raw{buffer.data(), buffer.size(), false};
+  if (!threshold or buffer.size() < threshold.get()) return raw;
+
+  const auto begin = std::chrono::steady_clock::now();
+  deflated.clear();
+  writeVarint(deflated, buffer.size());
+  lzCompress(reinterpret_cast<const unsigned char *>(buffer.data()),
+             buffer.size(), deflated);
+
+  stats.frames++;
+  stats.bytesIn += buffer.size();
+  stats.time += std::chrono::duration<TimeDiff>(
+      std::chrono::steady_clock::now() - begin).count();
+
+  if (deflated.size() >= buffer.size()) {
+    stats.bytesOut += buffer.size();
+    return raw;
+  }
+  stats.bytesOut += deflated.size();
+  return {reinterpret_cast<const char *>(deflated.data()),
+          deflated.size(), true};
+}
+
+bool FrameCompressor::inflate(const unsigned char *data, const size_t size,
+                              const unsigned char *&result,
+                              size_t &resultSize) {
+  size_t offset{0};
+  if (!readVarint(data, size, offset, resultSize)
+      or resultSize > maxInflatedSize) return false;
+  if (!lzDecompress(data + offset, size - offset, resultSize, inflated))
+    return false;
+  result = inflated.data();
+  return true;
+}
+
+/**
+ * Outbox.
+ */
+
+Outbox::Outbox(const size_t datagramSize) :
+    datagramSize(datagramSize),
+    messagesPushed(0),
+    messagesFlushed(0),
+    datagramsFlushed(0) { }
+
+std::shared_ptr<Outbox::Datagram> Outbox::createDatagram(
+    const size_t recipients) const {
+  auto datagram = std::make_shared<Datagram>();
+  datagram->data.reserve(datagramSize);
+  datagram->recipients = recipients;
+  datagram->packet = nullptr;
+  return datagram;
+}
+
+bool Outbox::fits(const Datagram &datagram, const Frame &frame) const {
+  // Frame headers are tiny, leave some slack for them.
+  return datagram.data.empty()
+      or datagram.data.size() + frame.size + 8 <= datagramSize;
+}
+
+void Outbox::push(ENetPeer *const peer, const Reliability reliability,
+                  const Frame &frame) {
+  auto &datagrams = queues[QueueKey(peer, reliability)];
+  if (datagrams.empty()) datagrams.reserve(4);
+  if (datagrams.empty() or datagrams.back()->recipients > 1
+      or !fits(*datagrams.back(), frame))
+    datagrams.push_back(createDatagram(1));
+
+  auto &datagram = datagrams.back()->data;
+  writeFrameHeader(datagram, frame);
+  datagram.insert(datagram.end(), frame.data, frame.data + frame.size);
+  messagesPushed++;
+}
+
+void Outbox::push(const std::vector<ENetPeer *> &peers,
+                  const Reliability reliability, const Frame &frame) {
+  if (peers.empty()) return;
+  if (peers.size() == 1) {
+    push(peers.front(), reliability, frame);
+    return;
+  }
+
+  // We can go on filling the last datagram if it's for exactly these peers.
+  std::shared_ptr<Datagram> shared;
+  const auto first = queues.find(QueueKey(peers.front(), reliability));
+  if (first != queues.end() and !first->second.empty()
+      and first->second.back()->recipients == peers.size()
+      and fits(*first->second.back(), frame)) {
+    shared = first->second.back();
+    for (const auto peer : peers) {
+      const auto queue = queues.find(QueueKey(peer, reliability));
+      if (queue == queues.end() or queue->second.empty()
+          or queue->second.back() != shared) {
+        shared.reset();
+        break;
+      }
+    }
+  }
+  if (!shared) {
+    shared = createDatagram(peers.size());
+    for (const auto peer : peers) {
+      auto &datagrams = queues[QueueKey(peer, reliability)];
+      if (datagrams.empty()) datagrams.reserve(4);
+      datagrams.push_back(shared);
+    }
+  }
+
+  auto &datagram = shared->data;
+  writeFrameHeader(datagram, frame);
+  datagram.insert(datagram.end(), frame.data, frame.data + frame.size);
+  messagesPushed += peers.size();
+}
+
+void Outbox::flush(Host &host) {
+  messagesFlushed = messagesPushed;
+  datagramsFlushed = 0;
+  messagesPushed = 0;
+
+  // Shared datagrams get their packet when we first come across them, and
+  // we let go of it once everyone they're for had their turn.
+  for (const auto &queue : queues) {
+    const Reliability reliability = queue.first.second;
+    for (const auto &datagram : queue.second) {
+      if (!datagram->packet) {
+        datagram->packet = enet_packet_create(
+            datagram->data.data(), datagram->data.size(),
+            packetFlagsOf(reliability));
+        datagramsFlushed++;
+      }
+      ENetPacket *const packet = datagram->packet;
+      host.transmit(queue.first.first, packet, reliability);
+      if (--datagram->recipients == 0 and packet->referenceCount == 0)
+        enet_packet_destroy(packet);
+    }
+  }
+  queues.clear();
+}
+
+void Outbox::drop(ENetPeer *const peer) {
+  auto iter = queues.begin();
+  while (iter != queues.end()) {
+    if (iter->first.first == peer) {
+      for (const auto &datagram : iter->second) datagram->recipients--;
+      iter = queues.erase(iter);
+    } else ++iter;
+  }
+}
+
+void Outbox::append(Outbox &&other) {
+  for (auto &queue : other.queues) {
+    auto &datagrams = queues[queue.first];
+    std::move(queue.second.begin(), queue.second.end(),
+              std::back_inserter(datagrams));
+  }
+  messagesPushed += other.messagesPushed;
+  other.queues.clear();
+  other.messagesPushed = 0;
+}
+
+Outbox Outbox::take() {
+  Outbox taken(datagramSize);
+  taken.queues.swap(queues);
+  taken.messagesPushed = messagesPushed;
+  messagesPushed = 0;
+  return taken;
+}
+
+/**
+ * ENetTransport.
+ */
+
+ENetTransport::ENetTransport(const HostType type, const Port port) :
+    host(nullptr) {
   switch (type) {
     case HostType::Server: {
       ENetAddress address;
       address.host = ENET_HOST_ANY;
       address.port = port;
       // no upstream / downstream bandwidth limits
-      host = enet_host_create(&address, 32, 1, 0, 0);
+      host = enet_host_create(&address, 32, channelCount, 0, 0);
       break;
     }
     case HostType::Client: {
       // sensible upstream / downstream bandwidth limits
-      host = enet_host_create(nullptr, 2, 1, 57600 / 8, 14400 / 8);
+      host = enet_host_create(
+          nullptr, 2, channelCount, 57600 / 8, 14400 / 8);
       break;
     }
   }
@@ -95,54 +563,186 @@ Host::Host(const HostType type, const Port port) :
     }
     throw std::runtime_error("Failed to create ENet host!");
   }
-
-  sampleBandwidth();
 }
 
-Host::~Host() {
+ENetTransport::~ENetTransport() {
   enet_host_destroy(host);
 }
 
-const std::vector<ENetPeer *> &Host::getPeers() const {
-  return peers;
-}
-
-ENetPeer *Host::connect(const std::string &address, const Port port) {
+ENetPeer *ENetTransport::connect(const std::string &address, const Port port) {
   ENetAddress eaddress;
   enet_address_set_host(&eaddress, address.c_str());
   eaddress.port = port;
 
   // Set a fairly short timeout period on the peer.
-  ENetPeer *peer = enet_host_connect(host, &eaddress, 1, 0);
+  ENetPeer *peer = enet_host_connect(host, &eaddress, channelCount, 0);
   enet_peer_timeout(peer, 0, 2000, 2000);
 
   return peer;
 }
 
-void Host::disconnect(ENetPeer *peer) {
+void ENetTransport::disconnect(ENetPeer *peer) {
   enet_peer_disconnect(peer, 0);
 }
 
+void ENetTransport::send(ENetPeer *peer, const enet_uint8 channel,
+                         ENetPacket *packet) {
+  enet_peer_send(peer, channel, packet);
+}
+
+int ENetTransport::service(ENetEvent &event, const enet_uint32 timeout) {
+  return enet_host_service(host, &event, timeout);
+}
+
+int ENetTransport::checkEvents(ENetEvent &event) {
+  return enet_host_check_events(host, &event);
+}
+
+void ENetTransport::flush() {
+  enet_host_flush(host);
+}
+
+Port ENetTransport::getPort() const {
+  return host->address.port;
+}
+
+void ENetTransport::takeDataTotals(size_t &received, size_t &sent) {
+  received = host->totalReceivedData;
+  sent = host->totalSentData;
+  host->totalReceivedData = 0;
+  host->totalSentData = 0;
+}
+
+/**
+ * Host.
+ */
+
+void Host::registerPeer(ENetPeer *peer) {
+  auto found = std::find(peers.begin(), peers.end(), peer);
+  if (found != peers.end()) {
+    *found = peer;
+  } else {
+    peers.push_back(peer);
+  }
+  std::lock_guard<std::mutex> lock(statsMutex);
+  peerRecords.emplace(
+      peer, PeerRecord{PeerStats(), LinkQuality(peer), peer->packetsLost});
+}
+
+void Host::unregisterPeer(ENetPeer *peer) {
+  auto found = std::find(peers.begin(), peers.end(), peer);
+  if (found != peers.end()) {
+    peers.erase(found);
+  }
+  std::lock_guard<std::mutex> lock(statsMutex);
+  peerRecords.erase(peer);
+}
+
+void Host::sampleBandwidth() {
+  size_t received, sent;
+  transport->takeDataTotals(received, sent);
+  std::lock_guard<std::mutex> lock(statsMutex);
+  lastIncomingBandwidth = float(received) / 1000.0f;
+  lastOutgoingBandwidth = float(sent) / 1000.0f;
+}
+
+void Host::samplePeers() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  for (auto &record : peerRecords) {
+    record.second.link = LinkQuality(record.first);
+    const enet_uint32 lost = record.first->packetsLost;
+    record.second.stats.retransmits += (lost >= record.second.lastPacketsLost)
+                                       ? lost - record.second.lastPacketsLost
+                                       : lost;
+    record.second.lastPacketsLost = lost;
+  }
+}
+
+Host::Host(const HostType type, const Port port) :
+    Host(std::make_unique<ENetTransport>(type, port)) { }
+
+Host::Host(std::unique_ptr<Transport> &&transport) :
+    transport(std::move(transport)),
+    bandwidthSampler(1) {
+  sampleBandwidth();
+}
+
+const std::vector<ENetPeer *> &Host::getPeers() const {
+  return peers;
+}
+
+ENetPeer *Host::connect(const std::string &address, const Port port) {
+  return transport->connect(address, port);
+}
+
+void Host::disconnect(ENetPeer *peer) {
+  transport->disconnect(peer);
+}
+
 void Host::transmit(ENetPeer *const peer,
                     unsigned char *data,
                     size_t size,
-                    const ENetPacketFlag flag) {
-  ENetPacket *packet = enet_packet_create(data, size, flag);
-  enet_peer_send(peer, 0, packet);
+                    const Reliability reliability) {
+  transmit(peer, enet_packet_create(data, size, packetFlagsOf(reliability)),
+           reliability);
+}
+
+void Host::transmit(ENetPeer *const peer, ENetPacket *const packet,
+                    const Reliability reliability) {
+  std::unique_lock<std::mutex> lock(statsMutex);
+  const auto record = peerRecords.find(peer);
+  if (record != peerRecords.end()) {
+    // Same rule ENet uses to decide to fragment.
+    const size_t fragmentLength = peer->mtu - sizeof(ENetProtocolHeader)
+        - sizeof(ENetProtocolSendFragment);
+    PeerStats &stats = record->second.stats;
+    stats.bytesSent += packet->dataLength;
+    stats.packetsSent++;
+    if (packet->dataLength > fragmentLength)
+      stats.fragmentsSent +=
+          (packet->dataLength + fragmentLength - 1) / fragmentLength;
+  }
+  lock.unlock();
+  transport->send(peer, channelOf(reliability), packet);
 }
 
-ENetEvent Host::poll() {
-  enet_host_service(host, &event, 0);
+void Host::trackPeers(const int serviceResult) {
+  if (serviceResult <= 0) event.type = ENET_EVENT_TYPE_NONE;
 
   if (event.type == ENET_EVENT_TYPE_CONNECT)
     registerPeer(event.peer);
   else if (event.type == ENET_EVENT_TYPE_DISCONNECT)
     unregisterPeer(event.peer);
+  else if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    const auto record = peerRecords.find(event.peer);
+    if (record != peerRecords.end()) {
+      record->second.stats.bytesReceived += event.packet->dataLength;
+      record->second.stats.packetsReceived++;
+    }
+  }
+}
+
+ENetEvent Host::poll(const enet_uint32 timeout) {
+  trackPeers(transport->service(event, timeout));
+  return event;
+}
 
+ENetEvent Host::checkEvents() {
+  trackPeers(transport->checkEvents(event));
   return event;
 }
 
+void Host::flush() {
+  transport->flush();
+}
+
+Port Host::getPort() const {
+  return transport->getPort();
+}
+
 void Host::tick(const TimeDiff delta) {
+  samplePeers();
   if (bandwidthSampler.cool(delta)) {
     sampleBandwidth();
     bandwidthSampler.reset();
@@ -150,13 +750,33 @@ void Host::tick(const TimeDiff delta) {
 }
 
 Kbps Host::incomingBandwidth() const {
+  std::lock_guard<std::mutex> lock(statsMutex);
   return lastIncomingBandwidth;
 }
 
 Kbps Host::outgoingBandwidth() const {
+  std::lock_guard<std::mutex> lock(statsMutex);
   return lastOutgoingBandwidth;
 }
 
+optional<PeerStats> Host::peerStats(const ENetPeer *peer) const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  const auto record = peerRecords.find(peer);
+  if (record == peerRecords.end()) return {};
+
+  PeerStats stats = record->second.stats;
+  stats.rtt = record->second.link.rtt;
+  stats.packetLoss = record->second.link.packetLoss;
+  return stats;
+}
+
+optional<LinkQuality> Host::linkQuality(const ENetPeer *peer) const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  const auto record = peerRecords.find(peer);
+  if (record == peerRecords.end()) return {};
+  return record->second.link;
+}
+
 std::string printAddress(const ENetAddress &addr) {
   union {
     ENetAddress addr;
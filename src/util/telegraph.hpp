@@ -20,11 +20,13 @@
  */
 #pragma once
 #include <sstream>
+#include <array>
 #include <boost/range/iterator_range_core.hpp>
 #include <enet/enet.h>
 #include "util/types.hpp"
 #include "util/methods.hpp"
 #include "printer.hpp"
+#include "threads.hpp"
 
 #include <cereal/archives/binary.hpp>
 
@@ -40,33 +42,198 @@ struct UsageFlag {
   ~UsageFlag();
 };
 
+/**
+ * How a packet is delivered. Each class has its own ENet channel, so a lost
+ * packet in one doesn't hold up the others.
+ */
+enum class Reliability {
+  ReliableOrdered, // resent until acknowledged, delivered in order
+  UnreliableSequenced, // may be lost, and is dropped if it arrives late
+  Unsequenced // may be lost, and is delivered as soon as it arrives
+};
+
+const size_t channelCount = 3;
+enet_uint8 channelOf(const Reliability reliability);
+enet_uint32 packetFlagsOf(const Reliability reliability);
+
+/**
+ * Delivery class of a value we transmit. Protocol types overload this in
+ * their own namespace, everything else is reliable.
+ */
+template<typename T>
+Reliability reliabilityOf(const T &) {
+  return Reliability::ReliableOrdered;
+}
+
+/**
+ * Name of a message's kind, for traffic statistics. Protocol types overload
+ * this in their own namespace.
+ */
+template<typename T>
+const char *messageKind(const T &) {
+  return "message";
+}
+
+/**
+ * Distribution of message sizes, in power-of-two buckets.
+ */
+class SizeHistogram: public Printable {
+ public:
+  static constexpr size_t bucketCount = 16; // the last one is open-ended
+
+ private:
+  std::array<size_t, bucketCount> buckets;
+
+ public:
+  SizeHistogram();
+
+  size_t count, bytes, max;
+
+  void record(const size_t size);
+  void merge(const SizeHistogram &other);
+  size_t bucket(const size_t index) const; // sizes below 2^(index + 1)
+
+  // Printable impl.
+  void print(Printer &p) const override;
+};
+
+/**
+ * Messages sent and received through a Telegraph, by kind. Sent messages
+ * are counted once per recipient, at their size on the wire.
+ */
+class TrafficStats: public Printable {
+ public:
+  std::map<std::string, SizeHistogram> sent, received;
+
+  void recordSent(const std::string &kind, const size_t size);
+  void recordReceived(const std::string &kind, const size_t size);
+  void merge(const TrafficStats &other);
+  void reset();
+
+  // Printable impl.
+  void print(Printer &p) const override;
+};
+
+/**
+ * Traffic with one peer of a Host, since it connected. Fragments are the
+ * pieces ENet splits packets bigger than the MTU into; retransmits are
+ * reliable commands ENet had to resend after a timeout.
+ */
+struct PeerStats: public Printable {
+  PeerStats();
+
+  size_t bytesSent, bytesReceived,
+      packetsSent, packetsReceived,
+      fragmentsSent, retransmits;
+  TimeDiff rtt;
+  float packetLoss;
+
+  // Printable impl.
+  void print(Printer &p) const override;
+};
+
+/**
+ * Quality of the link to a peer, as ENet measures it.
+ */
+struct LinkQuality {
+  LinkQuality(const ENetPeer *peer);
+  LinkQuality(const TimeDiff rtt, const float packetLoss = 0,
+              const float throttle = 1);
+
+  TimeDiff rtt; // round trip time
+  float packetLoss; // fraction of packets lost
+  float throttle; // fraction of unreliable packets ENet lets through
+};
+
 /**
  * Host type: client or server.
  */
 enum class HostType { Client, Server };
 
+/**
+ * What a Host sends and receives through. Peers, packets and events are
+ * ENet's types whatever the transport; packets handed to send() are
+ * reference-counted as enet_peer_send() does, and packets in RECEIVE events
+ * belong to the caller.
+ */
+class Transport {
+ public:
+  virtual ~Transport() { }
+
+  virtual ENetPeer *connect(const std::string &address, const Port port) = 0;
+  virtual void disconnect(ENetPeer *peer) = 0;
+  virtual void send(ENetPeer *peer, const enet_uint8 channel,
+                    ENetPacket *packet) = 0;
+  // Like enet_host_service() and enet_host_check_events().
+  virtual int service(ENetEvent &event, const enet_uint32 timeout) = 0;
+  virtual int checkEvents(ENetEvent &event) = 0;
+  virtual void flush() = 0;
+
+  virtual Port getPort() const = 0;
+  // Bytes that went through since the last call.
+  virtual void takeDataTotals(size_t &received, size_t &sent) = 0;
+};
+
+/**
+ * Transport over UDP sockets, with an ENet host.
+ */
+class ENetTransport: public Transport {
+ private:
+  ENetHost *host;
+
+ public:
+  ENetTransport(const HostType type, const Port port);
+  ~ENetTransport();
+
+  // Transport impl.
+  ENetPeer *connect(const std::string &address, const Port port) override;
+  void disconnect(ENetPeer *peer) override;
+  void send(ENetPeer *peer, const enet_uint8 channel,
+            ENetPacket *packet) override;
+  int service(ENetEvent &event, const enet_uint32 timeout) override;
+  int checkEvents(ENetEvent &event) override;
+  void flush() override;
+
+  Port getPort() const override;
+  void takeDataTotals(size_t &received, size_t &sent) override;
+};
+
 class Host {
  private:
   // Underlying state.
-  ENetHost *host;
+  std::unique_ptr<Transport> transport;
   ENetEvent event;
   std::vector<ENetPeer *> peers;
 
+  // Telemetry is read through the const API below, which is safe to call
+  // from other threads while one thread services the host.
+  mutable std::mutex statsMutex;
+
   // Bandwidth recording.
   Kbps lastIncomingBandwidth, lastOutgoingBandwidth;
   Cooldown bandwidthSampler;
   void sampleBandwidth();
 
+  // Per-peer telemetry.
+  struct PeerRecord {
+    PeerStats stats;
+    LinkQuality link; // as of the last tick
+    enet_uint32 lastPacketsLost; // ENet resets its count periodically
+  };
+  std::map<const ENetPeer *, PeerRecord> peerRecords;
+  void samplePeers();
+
   // Manging peers.
   void registerPeer(ENetPeer *peer);
   void unregisterPeer(ENetPeer *peer);
+  void trackPeers(const int serviceResult);
 
  public:
   Host(const Host &) = delete;
   Host &operator=(const Host &) = delete;
   Host(const HostType type,
        const Port port = 0);
-  ~Host();
+  Host(std::unique_ptr<Transport> &&transport);
 
   // User API.
   const std::vector<ENetPeer *> &getPeers() const;
@@ -74,15 +241,192 @@ class Host {
   void disconnect(ENetPeer *);
   void transmit(ENetPeer *const peer,
                 unsigned char *data, size_t size,
-                const ENetPacketFlag flag);
+                const Reliability reliability);
+  void transmit(ENetPeer *const peer, ENetPacket *const packet,
+                const Reliability reliability);
 
-  ENetEvent poll();
+  // Service the host, waiting at most `timeout` milliseconds for an event.
+  ENetEvent poll(const enet_uint32 timeout = 0);
+  // Events already received, without touching the socket.
+  ENetEvent checkEvents();
+  // Send everything queued right away.
+  void flush();
+  Port getPort() const;
   void tick(const TimeDiff delta);
 
   // Expressed in average kB per second.
   Kbps incomingBandwidth() const;
   Kbps outgoingBandwidth() const;
 
+  // Telemetry for a connected peer.
+  optional<PeerStats> peerStats(const ENetPeer *peer) const;
+  optional<LinkQuality> linkQuality(const ENetPeer *peer) const;
+
+};
+
+/**
+ * Adaptive send interval for a peer, between bounds. Backs off
+ * multiplicatively when the link shows congestion (loss, throttling, or the
+ * RTT rising above its floor) or the host is over its bandwidth budget, and
+ * speeds up additively otherwise.
+ */
+class RateControl {
+ private:
+  TimeDiff minInterval, maxInterval;
+  TimeDiff interval, elapsed;
+  optional<TimeDiff> baseRtt;
+
+ public:
+  RateControl(const TimeDiff minInterval, const TimeDiff maxInterval,
+              const TimeDiff initialInterval);
+
+  // `budgetUse` is the host's outgoing bandwidth over its budget.
+  void update(const LinkQuality &link, const float budgetUse = 0);
+  void tick(const TimeDiff delta);
+  bool due() const;
+  void reset(); // after sending
+
+  TimeDiff getInterval() const;
+};
+
+/**
+ * Growable byte buffer that an std::ostream can write into. Clearing it keeps
+ * its storage around, so encoding packets into it doesn't touch the heap once
+ * it has grown to fit the largest packet we send.
+ */
+class OutputBuffer: public std::streambuf {
+ private:
+  std::vector<char> storage;
+  size_t length;
+
+ protected:
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+  int_type overflow(int_type ch) override;
+
+ public:
+  OutputBuffer();
+
+  void clear();
+  const char *data() const;
+  size_t size() const;
+};
+
+/**
+ * Read-only view over a block of memory that an std::istream can read from.
+ * Doesn't copy or own the memory; it must outlive the view.
+ */
+class InputBuffer: public std::streambuf {
+ public:
+  InputBuffer(const unsigned char *data, const size_t size);
+};
+
+/**
+ * Unsigned integers in 7-bit groups, smallest first.
+ */
+void writeVarint(std::vector<unsigned char> &buffer, size_t x);
+bool readVarint(const unsigned char *data, const size_t size,
+                size_t &offset, size_t &x);
+
+/**
+ * Packets are sequences of frames: a message prefixed with a varint of its
+ * length and a flag telling if it's compressed. This lets several messages
+ * share one datagram.
+ */
+struct Frame {
+  const char *data;
+  size_t size;
+  bool compressed;
+};
+
+void writeFrameHeader(std::vector<unsigned char> &buffer, const Frame &frame);
+ENetPacket *createFramedPacket(const Frame &frame,
+                               const Reliability reliability);
+// Reads the header of the frame at `offset`, advancing past it.
+bool readFrameHeader(const unsigned char *data, const size_t size,
+                     size_t &offset, size_t &length, bool &compressed);
+
+/**
+ * Whether a value we transmit may be compressed. Protocol types overload
+ * this in their own namespace for their big messages.
+ */
+template<typename T>
+bool compressible(const T &) {
+  return false;
+}
+
+/**
+ * Statistics of a FrameCompressor.
+ */
+struct CompressionStats {
+  CompressionStats();
+
+  size_t frames, bytesIn, bytesOut;
+  TimeDiff time; // spent compressing
+
+  void merge(const CompressionStats &other);
+  void reset();
+  std::string print() const;
+};
+
+/**
+ * Compresses frames that are big enough to be worth it, and inflates
+ * compressed frames. Compression is flagged per frame, so receivers
+ * understand it without any setup; senders opt in by setting a threshold.
+ */
+class FrameCompressor {
+ private:
+  std::vector<unsigned char> deflated, inflated;
+
+ public:
+  FrameCompressor();
+
+  optional<size_t> threshold; // minimum size to compress, if enabled
+  CompressionStats stats;
+
+  Frame compress(const OutputBuffer &buffer);
+  bool inflate(const unsigned char *data, const size_t size,
+               const unsigned char *&result, size_t &resultSize);
+};
+
+/**
+ * Outgoing messages, queued per peer and reliability class and sent as few
+ * datagrams as possible when flushed. Datagrams are kept under the size
+ * that fits into one ENet fragment; bigger messages go on their own.
+ *
+ * Messages pushed to several peers at once go in datagrams shared between
+ * them, sent as one ENetPacket; messages to one peer are coalesced with
+ * what else that peer gets on its own. Each peer still gets everything in
+ * the order it was pushed.
+ */
+class Outbox {
+ private:
+  struct Datagram {
+    std::vector<unsigned char> data;
+    size_t recipients; // queues it's in
+    ENetPacket *packet; // once we're flushing it
+  };
+  using QueueKey = std::pair<ENetPeer *, Reliability>;
+  std::map<QueueKey, std::vector<std::shared_ptr<Datagram>>> queues;
+  const size_t datagramSize;
+  size_t messagesPushed;
+
+  std::shared_ptr<Datagram> createDatagram(const size_t recipients) const;
+  bool fits(const Datagram &datagram, const Frame &frame) const;
+
+ public:
+  Outbox(const size_t datagramSize = 1200);
+
+  void push(ENetPeer *const peer, const Reliability reliability,
+            const Frame &frame);
+  void push(const std::vector<ENetPeer *> &peers,
+            const Reliability reliability, const Frame &frame);
+  void flush(Host &host);
+  void drop(ENetPeer *const peer); // the peer disconnected
+  Outbox take(); // everything pushed so far, leaving this empty
+  void append(Outbox &&other); // queue another outbox's datagrams after ours
+
+  // Stats from the last flush: messages per peer, packets created.
+  size_t messagesFlushed, datagramsFlushed;
 };
 
 /**
@@ -91,63 +435,201 @@ class Host {
 template<typename ReceiveType>
 class Telegraph {
  private:
-  ReceiveType receiveBuffer;
+  OutputBuffer outputBuffer;
+  std::ostream outputStream;
+  std::vector<ENetPeer *> recipients; // of what we're posting
+
+  template<typename TransmitType>
+  Frame encodeFrame(const TransmitType &x) {
+    encode(x);
+    if (compressible(x)) return compression.compress(outputBuffer);
+    return {outputBuffer.data(), outputBuffer.size(), false};
+  }
+
+  optional<ReceiveType> decodeFrame(const unsigned char *data,
+                                    const size_t size,
+                                    const bool compressed) {
+    if (!compressed) return decode(data, size);
+
+    const unsigned char *inflated;
+    size_t inflatedSize;
+    if (!compression.inflate(data, size, inflated, inflatedSize)) {
+      appLog("Malformed packet: failed to decompress!", LogOrigin::Network);
+      return {};
+    }
+    return decode(inflated, inflatedSize);
+  }
 
  public:
-  Telegraph() { }
+  Telegraph() : outputStream(&outputBuffer) { }
+  Telegraph(const Telegraph &) = delete;
+  Telegraph &operator=(const Telegraph &) = delete;
 
-  // TODO: use the stringstream less stupidly?
+  FrameCompressor compression;
+  TrafficStats traffic;
 
+  /**
+   * Serialize a value into our output buffer, overwriting what was there.
+   */
   template<typename TransmitType>
-  std::string outputToString(const TransmitType &x) {
-    std::stringstream outputStream;
-    cereal::BinaryOutputArchive output(outputStream);
-    output(x);
-    return outputStream.str();
+  const OutputBuffer &encode(const TransmitType &x) {
+    outputBuffer.clear();
+    {
+      cereal::BinaryOutputArchive output(outputStream);
+      output(x);
+    }
+    return outputBuffer;
+  }
+
+  /**
+   * Encode a value into a fresh ENet packet of one frame, with a reference
+   * count of zero.
+   */
+  template<typename TransmitType>
+  ENetPacket *encodePacket(const TransmitType &x,
+                           const Reliability reliability) {
+    return createFramedPacket(encodeFrame(x), reliability);
   }
 
   /**
    * Transmit a packet to one peer.
    */
+  template<typename TransmitType>
+  void transmit(
+      Host &host, ENetPeer *const peer,
+      const TransmitType &value) {
+    transmit(host, peer, value, reliabilityOf(value));
+  }
+
   template<typename TransmitType>
   void transmit(
       Host &host, ENetPeer *const peer,
       const TransmitType &value,
-      const bool guaranteeOrder = true) {
-    transmit(host, [peer](auto f) { f(peer); },
-             value, guaranteeOrder);
+      const Reliability reliability) {
+    transmit(host, [peer](auto f) { f(peer); }, value, reliability);
   }
 
   /**
-   * Transmit same packet to a range of peers.
+   * Transmit same packet to a range of peers. The value is encoded once, and
+   * every peer is handed a reference to the same ENet packet.
    */
+  template<typename TransmitType>
+  void transmit(
+      Host &host,
+      std::function<void(std::function<void(ENetPeer *const)>)> callPeers,
+      const TransmitType &value) {
+    transmit(host, callPeers, value, reliabilityOf(value));
+  }
+
   template<typename TransmitType>
   void transmit(
       Host &host,
       std::function<void(std::function<void(ENetPeer *const)>)> callPeers,
       const TransmitType &value,
-      const bool guaranteeOrder = true) {
-    std::string data = outputToString(value);
+      const Reliability reliability) {
+    const Frame frame = encodeFrame(value);
+    ENetPacket *packet = createFramedPacket(frame, reliability);
+    const std::string kind = messageKind(value);
+    callPeers([&](ENetPeer *const peer) {
+      host.transmit(peer, packet, reliability);
+      traffic.recordSent(kind, frame.size);
+    });
+    // Nobody took a reference, we have to clean up ourselves.
+    if (packet->referenceCount == 0) enet_packet_destroy(packet);
+  }
+
+  /**
+   * Queue a value for a range of peers in an Outbox, to be sent when it's
+   * flushed. The value is still only encoded once, and shared between the
+   * peers in one packet.
+   */
+  template<typename TransmitType>
+  void post(
+      Outbox &outbox,
+      std::function<void(std::function<void(ENetPeer *const)>)> callPeers,
+      const TransmitType &value) {
+    const Frame frame = encodeFrame(value);
+    const std::string kind = messageKind(value);
+    recipients.clear();
     callPeers([&](ENetPeer *const peer) {
-      host.transmit(peer, (unsigned char *) data.c_str(), data.size(),
-                    (guaranteeOrder ? ENET_PACKET_FLAG_RELIABLE
-                                    : ENET_PACKET_FLAG_UNSEQUENCED));
+      recipients.push_back(peer);
+      traffic.recordSent(kind, frame.size);
     });
+    outbox.push(recipients, reliabilityOf(value), frame);
   }
 
+  template<typename TransmitType>
+  void post(Outbox &outbox, ENetPeer *const peer, const TransmitType &value) {
+    const Frame frame = encodeFrame(value);
+    outbox.push(peer, reliabilityOf(value), frame);
+    traffic.recordSent(messageKind(value), frame.size);
+  }
+
+  /**
+   * Decode every message in a packet, handing them to a callback in order.
+   */
+  template<typename Callback>
+  void receive(const ENetPacket *packet, Callback &&callback) {
+    receiveSized(packet, [&](ReceiveType &&value, const size_t) {
+      callback(std::move(value));
+    });
+  }
+
+  /**
+   * Like receive(), also handing the callback the size of each message's
+   * frame.
+   */
+  template<typename Callback>
+  void receiveSized(const ENetPacket *packet, Callback &&callback) {
+    size_t offset{0}, length;
+    bool compressed;
+    while (offset < packet->dataLength) {
+      if (!readFrameHeader(packet->data, packet->dataLength,
+                           offset, length, compressed)) {
+        appLog("Malformed packet: broken framing!", LogOrigin::Network);
+        return;
+      }
+      if (auto value = decodeFrame(packet->data + offset, length, compressed)) {
+        traffic.recordReceived(messageKind(*value), length);
+        callback(std::move(*value), length);
+      }
+      offset += length;
+    }
+  }
+
+  /**
+   * Decode the first message in a packet, for packets we know carry one.
+   */
   optional<ReceiveType> receive(const ENetPacket *packet) {
-    std::string data((const char *) packet->data, packet->dataLength);
-    std::stringstream inputStream(data);
-    cereal::BinaryInputArchive input(inputStream);
+    size_t offset{0}, length;
+    bool compressed;
+    if (!readFrameHeader(packet->data, packet->dataLength,
+                         offset, length, compressed)) {
+      appLog("Malformed packet: broken framing!", LogOrigin::Network);
+      return {};
+    }
+    auto value = decodeFrame(packet->data + offset, length, compressed);
+    if (value) traffic.recordReceived(messageKind(*value), length);
+    return value;
+  }
+
+  /**
+   * Decode a message, reading straight from the packet's memory. The result
+   * is constructed in place and can be moved on to its consumer.
+   */
+  optional<ReceiveType> decode(const unsigned char *data, const size_t size) {
+    InputBuffer inputBuffer(data, size);
+    std::istream inputStream(&inputBuffer);
 
-    receiveBuffer = ReceiveType();
+    optional<ReceiveType> value;
+    value.emplace();
     try {
-      input(receiveBuffer);
-      if (!verifyValue(receiveBuffer)) {
+      cereal::BinaryInputArchive input(inputStream);
+      input(*value);
+      if (!verifyValue(*value)) {
         appLog("Malformed packet: violated invariants!", LogOrigin::Network);
-//        appLogValue(receiveBuffer);
       } else {
-        return receiveBuffer;
+        return value;
       }
     } catch (...) {
       appLog("Malformed packet: failed to decode!", LogOrigin::Network);
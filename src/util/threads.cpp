@@ -0,0 +1,109 @@
+/**
+ * solemnsky: the open-source multiplayer competitive 2D plane game
+ * Copyright (C) 2016  Chris Gadzinski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "threads.hpp"
+
+/**
+ * ThreadPool.
+ */
+
+void ThreadPool::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    taskReady.wait(lock, [&]() { return stopping or !tasks.empty(); });
+    if (tasks.empty()) return; // stopping, and nothing left to do
+
+    auto task = std::move(tasks.front());
+    tasks.pop_front();
+
+    lock.unlock();
+    std::exception_ptr taskError;
+    try {
+      task();
+    } catch (...) {
+      taskError = std::current_exception();
+    }
+    lock.lock();
+
+    if (taskError and !error) error = taskError;
+    if (--pending == 0) tasksDone.notify_all();
+  }
+}
+
+ThreadPool::ThreadPool(const size_t size) :
+    pending(0),
+    stopping(false) {
+  const size_t count = size ? size
+                            : std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < count; i++)
+    threads.emplace_back([this]() { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskReady.notify_all();
+  for (auto &thread : threads) thread.join();
+}
+
+void ThreadPool::run(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+    pending++;
+  }
+  taskReady.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  tasksDone.wait(lock, [&]() { return pending == 0; });
+  if (error) {
+    std::exception_ptr thrown;
+    std::swap(thrown, error);
+    std::rethrow_exception(thrown);
+  }
+}
+
+size_t ThreadPool::size() const {
+  return threads.size();
+}
+
+/**
+ * Latch.
+ */
+
+Latch::Latch(const size_t count) :
+    count(count) { }
+
+void Latch::countDown() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (count > 0 and --count == 0) finished.notify_all();
+}
+
+bool Latch::done() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return count == 0;
+}
+
+void Latch::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [&]() { return count == 0; });
+}
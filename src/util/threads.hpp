@@ -16,21 +16,146 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 /**
- * Gives us std::thread and std::mutex. If we're on MinGW, uses the thirdparty
- * mingw-std-threads library.
+ * Gives us std::thread, std::mutex and std::condition_variable. If we're on
+ * MinGW, uses the thirdparty mingw-std-threads library.
+ *
+ * Also home to the thread utilities built on them.
  */
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <boost/optional.hpp>
 
 #ifdef __linux
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #endif
 
 #ifdef __APPLE__
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #endif
 
 #ifdef _WIN32
 #include <mingw.thread.h>
 #include <mingw.mutex.h>
+#include <mingw.condition_variable.h>
 #endif
+
+/**
+ * Fixed set of worker threads running tasks from a queue. wait() blocks
+ * until every task run so far is done, and rethrows the first exception one
+ * of them threw.
+ */
+class ThreadPool {
+ private:
+  std::vector<std::thread> threads;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable taskReady, tasksDone;
+  size_t pending; // queued or running
+  std::exception_ptr error;
+  bool stopping;
+
+  void work();
+
+ public:
+  ThreadPool(const size_t size = 0); // (0: one per hardware thread)
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  void run(std::function<void()> task);
+  void wait();
+  size_t size() const;
+};
+
+/**
+ * Counts down as tasks finish; wait() blocks until all of them have.
+ */
+class Latch {
+ private:
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t count;
+
+ public:
+  Latch(const size_t count);
+  Latch(const Latch &) = delete;
+  Latch &operator=(const Latch &) = delete;
+
+  void countDown();
+  bool done(); // without blocking
+  void wait();
+};
+
+/**
+ * Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread. push() and pop() never block; they fail when the queue is
+ * full or empty respectively.
+ */
+template<typename T>
+class SpscQueue {
+ private:
+  using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  const size_t slotCount; // one more than the capacity
+  std::unique_ptr<Slot[]> slots;
+  // On their own cache lines, so the two threads don't fight over them.
+  alignas(64) std::atomic<size_t> head; // next to pop, owned by the consumer
+  alignas(64) std::atomic<size_t> tail; // next to push, owned by the producer
+
+  T *slot(const size_t i) { return reinterpret_cast<T *>(&slots[i]); }
+
+ public:
+  SpscQueue(const size_t capacity) :
+      slotCount(capacity + 1),
+      slots(new Slot[capacity + 1]),
+      head(0),
+      tail(0) { }
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+  ~SpscQueue() { while (pop()) { } }
+
+  /**
+   * Producer: enqueue a value, unless the queue is full. The value is only
+   * moved from if this succeeds.
+   */
+  bool push(T &&value) {
+    const size_t index = tail.load(std::memory_order_relaxed);
+    const size_t next = (index + 1) % slotCount;
+    if (next == head.load(std::memory_order_acquire)) return false;
+
+    new (slot(index)) T(std::move(value));
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer: dequeue the oldest value, if there is one.
+   */
+  boost::optional<T> pop() {
+    const size_t index = head.load(std::memory_order_relaxed);
+    if (index == tail.load(std::memory_order_acquire)) return {};
+
+    boost::optional<T> value(std::move(*slot(index)));
+    slot(index)->~T();
+    head.store((index + 1) % slotCount, std::memory_order_release);
+    return value;
+  }
+
+  /**
+   * Either side: a snapshot, which may be stale by the time you look at it.
+   */
+  bool empty() const {
+    return head.load(std::memory_order_acquire)
+        == tail.load(std::memory_order_acquire);
+  }
+};
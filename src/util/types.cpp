@@ -18,6 +18,7 @@
 #define _USE_MATH_DEFINES // for M_PI
 #include <cmath>
 #include <numeric>
+#include <cstring>
 #include "types.hpp"
 #include "methods.hpp"
 #include "printer.hpp"
@@ -29,12 +30,41 @@
 TimeStats::TimeStats(const RollingSampler<TimeDiff> &sampler) :
     min(sampler.min()),
     mean(sampler.mean<TimeDiff>()),
-    max(sampler.max()) { }
+    max(sampler.max()),
+    p99(sampler.percentile(0.99)) { }
 
 std::string TimeStats::print() const {
   return printTimeDiff(mean) + ":"
       + printTimeDiff(min) + "->"
-      + printTimeDiff(max);
+      + printTimeDiff(max) + " (p99 " + printTimeDiff(p99) + ")";
+}
+
+/**
+ * FixedTimestep.
+ */
+
+FixedTimestep::FixedTimestep(const TimeDiff interval, const size_t maxCatchUp) :
+    accumulator(0),
+    interval(interval),
+    maxCatchUp(maxCatchUp),
+    dropped(0),
+    lateness(0) { }
+
+size_t FixedTimestep::advance(const Time elapsed) {
+  accumulator += elapsed;
+  dropped = 0;
+  const size_t due = size_t(accumulator / interval);
+  if (due == 0) return 0;
+
+  lateness = accumulator - interval;
+  accumulator -= due * Time(interval);
+  if (due <= maxCatchUp) return due;
+  dropped = due - maxCatchUp;
+  return maxCatchUp;
+}
+
+Time FixedTimestep::untilNext() const {
+  return interval - accumulator;
 }
 /**
  * MovementLaws.
@@ -117,6 +147,47 @@ sf::Vector2f Angle::toVector() {
   return sf::Vector2f((float) cos(rad), (float) sin(rad));
 }
 
+/**
+ * Quantizer.
+ */
+
+Quantizer::Quantizer(const Precision precision,
+                     const float min, const float max) :
+    precision(precision), min(min), max(max) { }
+
+uint32_t Quantizer::encode(const float x) const {
+  switch (precision) {
+    case Precision::Full: {
+      uint32_t code;
+      std::memcpy(&code, &x, sizeof(code));
+      return code;
+    }
+    case Precision::Fixed16:
+    case Precision::Fixed8: {
+      const float steps = (precision == Precision::Fixed16) ? 65535 : 255;
+      return uint32_t(std::lround(
+          (clamp(min, max, x) - min) / (max - min) * steps));
+    }
+  }
+  throw std::logic_error("bad enum");
+}
+
+float Quantizer::decode(const uint32_t code) const {
+  switch (precision) {
+    case Precision::Full: {
+      float x;
+      std::memcpy(&x, &code, sizeof(x));
+      return x;
+    }
+    case Precision::Fixed16:
+    case Precision::Fixed8: {
+      const float steps = (precision == Precision::Fixed16) ? 65535 : 255;
+      return min + (float(code) / steps) * (max - min);
+    }
+  }
+  throw std::logic_error("bad enum");
+}
+
 Movement addMovement(const bool down, const bool up) {
   if (up == down) return Movement::None;
   if (up) return Movement::Up;
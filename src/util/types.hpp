@@ -28,6 +28,8 @@
 #include <boost/optional.hpp>
 #include <SFML/Graphics.hpp>
 #include <bitset>
+#include <cstdint>
+#include <algorithm>
 
 /**
  * The concept of a type that can verify some invariant that could be
@@ -50,7 +52,7 @@ using boost::optional;
  */
 using Time = double;
 using TimeDiff = float;
-using Kbps = float;
+using Kbps = float; // kilobytes per second, as ENet counts them
 
 /**
  * Cereal rules, in both meanings of the word.
@@ -164,40 +166,153 @@ bool approach(T &x, const T target, const T amount) {
 
 /**
  * Maintains a rolling sampling window, which can be queried for statistics.
- * TODO: optimize this if necessary
+ *
+ * The window is a ring buffer with a running sum, and the minimum and
+ * maximum are kept in monotonic queues, so pushing and querying them are
+ * O(1) (amortized). Samplers given a range also keep bucketed counts of the
+ * window, for approximate percentiles in O(buckets); without one,
+ * percentiles are exact, selected from a copy of the window in O(n).
  */
 template<typename Data>
 class RollingSampler {
  private:
-  std::vector<Data> data;
+  std::vector<Data> data; // ring buffer, `next` is the oldest when full
+  size_t next;
   const unsigned int maxMemory;
 
+  size_t pushes;
+  Data sum;
+
+  // Counts of the window's samples in equal buckets from `low`, if we have a
+  // range; samples outside it count in the end buckets.
+  std::vector<unsigned int> counts;
+  double low, width;
+
+  size_t bucketOf(const Data value) const {
+    const double position = (double(value) - low) / width;
+    if (!(position > 0)) return 0;
+    return std::min(counts.size() - 1, size_t(position));
+  }
+
+  // Candidates for the minimum or maximum of the window: a queue of samples
+  // and the push they came in, monotonic in value, in a ring of the window's
+  // size.
+  struct Extremes {
+    std::vector<std::pair<size_t, Data>> ring;
+    size_t front, size;
+  };
+  Extremes minima, maxima;
+
+  template<typename Keeps>
+  void slide(Extremes &queue, const size_t index, const Data value,
+             Keeps keeps) {
+    // Only the oldest sample can leave the window.
+    if (queue.size > 0 and queue.ring[queue.front].first + maxMemory <= index) {
+      if (++queue.front == maxMemory) queue.front = 0;
+      queue.size--;
+    }
+
+    // Samples the new one beats can never be the extreme again.
+    while (queue.size > 0
+        and !keeps(queue.ring[wrap(queue.front + queue.size - 1)].second,
+                   value)) {
+      queue.size--;
+    }
+
+    queue.ring[wrap(queue.front + queue.size)] = {index, value};
+    queue.size++;
+  }
+
+  size_t wrap(const size_t position) const {
+    return position >= maxMemory ? position - maxMemory : position;
+  }
+
  public:
   RollingSampler() = delete;
   RollingSampler(const unsigned int maxMemory) :
-      maxMemory(maxMemory) { }
+      next(0), maxMemory(maxMemory), pushes(0), sum(0), low(0), width(1),
+      minima{std::vector<std::pair<size_t, Data>>(maxMemory), 0, 0},
+      maxima{std::vector<std::pair<size_t, Data>>(maxMemory), 0, 0} {
+    data.reserve(maxMemory);
+  }
+
+  RollingSampler(const unsigned int maxMemory,
+                 const Data low, const Data high,
+                 const unsigned int buckets = 64) :
+      RollingSampler(maxMemory) {
+    counts.assign(buckets, 0);
+    this->low = double(low);
+    width = (double(high) - double(low)) / buckets;
+  }
 
   void push(const Data value) {
-    if (data.size() >= maxMemory) data.erase(data.begin());
-    data.push_back(value);
+    if (data.size() < maxMemory) {
+      data.push_back(value);
+    } else {
+      sum -= data[next];
+      if (!counts.empty()) counts[bucketOf(data[next])]--;
+      data[next] = value;
+    }
+    sum += value;
+    if (!counts.empty()) counts[bucketOf(value)]++;
+
+    // Adding and subtracting floats drifts; start over once per window.
+    if (++next == maxMemory) {
+      next = 0;
+      sum = std::accumulate(data.begin(), data.end(), Data(0));
+    }
+
+    const size_t index = pushes++;
+    slide(minima, index, value,
+          [](const Data &kept, const Data &x) { return kept < x; });
+    slide(maxima, index, value,
+          [](const Data &kept, const Data &x) { return x < kept; });
   }
 
   template<typename Result>
   Result mean() const {
     if (data.size() == 0) return 0;
-    return Result(std::accumulate(
-        data.begin(), data.end(), Data(0), std::plus<Data>()))
-        / Result(data.size());
+    return Result(sum) / Result(data.size());
   }
 
   Data max() const {
     if (data.size() == 0) return 0;
-    return *std::max_element(data.begin(), data.end());
+    return maxima.ring[maxima.front].second;
   }
 
   Data min() const {
     if (data.size() == 0) return 0;
-    return *std::min_element(data.begin(), data.end());
+    return minima.ring[minima.front].second;
+  }
+
+  // The value `fraction` of the way up the sorted window, e.g. 0.95 for p95.
+  // With buckets, it's interpolated within the one it falls in.
+  Data percentile(const float fraction) const {
+    if (data.size() == 0) return 0;
+    const size_t rank = std::min(
+        data.size() - 1, size_t(fraction * float(data.size())));
+
+    if (!counts.empty()) {
+      // Walking in from the nearer end; high percentiles are the usual ones.
+      size_t below = 0, i = 0;
+      if (2 * rank < data.size()) {
+        while (below + counts[i] <= rank) below += counts[i++];
+      } else {
+        below = data.size();
+        i = counts.size();
+        do { below -= counts[--i]; } while (below > rank);
+      }
+      const double within = (double(rank - below) + 0.5) / counts[i];
+      return clamp(min(), max(), Data(low + width * (i + within)));
+    }
+
+    std::vector<Data> sorted(data);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+  }
+
+  size_t size() const {
+    return data.size();
   }
 };
 
@@ -205,7 +320,7 @@ struct TimeStats {
   TimeStats() = default;
   TimeStats(const RollingSampler<TimeDiff> &sampler);
 
-  TimeDiff min, mean, max;
+  TimeDiff min, mean, max, p99;
   std::string print() const;
 
 };
@@ -297,6 +412,32 @@ struct Scheduler {
 
 };
 
+/**
+ * A fixed-rate clock for a simulation, fed the real time that passes. It hands
+ * out whole steps of `interval`, at most `maxCatchUp` at once: when we've
+ * fallen further behind than that, the extra steps are dropped rather than
+ * run back-to-back, which would only leave us further behind.
+ */
+struct FixedTimestep {
+ private:
+  Time accumulator; // real time not yet stepped through
+
+ public:
+  FixedTimestep() = delete;
+  FixedTimestep(const TimeDiff interval, const size_t maxCatchUp);
+
+  const TimeDiff interval;
+  const size_t maxCatchUp;
+
+  size_t dropped; // steps given up on, at the last advance
+  Time lateness; // how overdue the first step due was, at the last advance
+
+  // Returns how many steps are due now, after `elapsed` more real time.
+  size_t advance(const Time elapsed);
+  Time untilNext() const;
+
+};
+
 /**
  * Float in the [0, 1] range.
  */
@@ -400,6 +541,73 @@ struct Angle {
   inline operator float() const { return value; }
 };
 
+/**
+ * Precision a float can be quantized to, for compact transmission.
+ */
+enum class Precision {
+  Full, // 32 bits, lossless
+  Fixed16, // 16-bit fixed point over a known range
+  Fixed8 // 8-bit fixed point over a known range
+};
+
+/**
+ * Maps floats in a [min, max] range to integer codes of some Precision, and
+ * back. Values outside of the range are clamped into it.
+ */
+struct Quantizer {
+  Quantizer() = delete;
+  Quantizer(const Precision precision, const float min, const float max);
+
+  Precision precision;
+  float min, max;
+
+  uint32_t encode(const float x) const;
+  float decode(const uint32_t code) const;
+};
+
+/**
+ * Quantized codes take as many bytes on the wire as their Precision needs.
+ */
+template<typename Archive>
+void saveQuantized(Archive &ar, const Precision precision, const uint32_t code) {
+  switch (precision) {
+    case Precision::Full: {
+      ar(code);
+      break;
+    }
+    case Precision::Fixed16: {
+      ar(uint16_t(code));
+      break;
+    }
+    case Precision::Fixed8: {
+      ar(uint8_t(code));
+      break;
+    }
+  }
+}
+
+template<typename Archive>
+uint32_t loadQuantized(Archive &ar, const Precision precision) {
+  switch (precision) {
+    case Precision::Full: {
+      uint32_t code;
+      ar(code);
+      return code;
+    }
+    case Precision::Fixed16: {
+      uint16_t code;
+      ar(code);
+      return code;
+    }
+    case Precision::Fixed8: {
+      uint8_t code;
+      ar(code);
+      return code;
+    }
+  }
+  throw std::logic_error("bad enum");
+}
+
 /**
  * Types and type synonyms for the game.
  */
@@ -448,15 +656,26 @@ struct SwitchSet {
     return bitset == set.bitset;
   }
 
-  // Cereal serialization.
+  // Cereal serialization, packed eight switches to a byte.
+  template<typename Archive>
+  void save(Archive &ar) const {
+    for (size_t i = 0; i < size_t(Enum::MAX); i += 8) {
+      uint8_t packed{0};
+      for (size_t j = i; j < std::min(i + 8, size_t(Enum::MAX)); ++j) {
+        if (bitset[j]) packed |= uint8_t(1 << (j - i));
+      }
+      ar(packed);
+    }
+  }
+
   template<typename Archive>
-  void serialize(Archive &ar) {
-    bool x;
-    for (size_t i = 0; i < size_t(Enum::MAX); ++i) {
-      x = bitset[i];
-      ar(x);
-      bitset[i] = x;
-      // Heh.
+  void load(Archive &ar) {
+    for (size_t i = 0; i < size_t(Enum::MAX); i += 8) {
+      uint8_t packed;
+      ar(packed);
+      for (size_t j = i; j < std::min(i + 8, size_t(Enum::MAX)); ++j) {
+        bitset[j] = bool(packed & (1 << (j - i)));
+      }
     }
   }
 
@@ -12,20 +12,99 @@ class FlowTest: public testing::Test {
 
 };
 
-// Pseudorandom offset values for the simulation.
-static std::vector<Time> offsets = {
-  
-};
+// Pseudorandom offset values for the simulation: 25 ms of transit, up to
+// 20 ms of jitter, and every 40th message 300 ms late.
+static std::vector<Time> offsets = [] {
+  std::vector<Time> offsets;
+  unsigned int seed = 1;
+  for (size_t i = 0; i < 1200; i++) {
+    seed = seed * 1103515245 + 12345;
+    const Time jitter = 0.02 * ((seed >> 16) % 1000) / 1000.0;
+    offsets.push_back(0.025 + jitter + (i % 40 == 39 ? 0.3 : 0));
+  }
+  return offsets;
+}();
 
 /**
  * We simulate a connection and verify some statistical properties about the results.
  */
 TEST_F(FlowTest, Simulation) {
+  // Messages are sent at 60 Hz; we poll every millisecond.
+  std::vector<std::pair<Time, size_t>> arrivals;
+  for (size_t i = 0; i < offsets.size(); i++)
+    arrivals.emplace_back(i / 60.0 + offsets[i], i);
+  std::sort(arrivals.begin(), arrivals.end());
+
+  std::vector<Time> released(offsets.size(), -1);
+  auto arrival = arrivals.begin();
+  for (size_t tick = 0; tick < 21000; tick++) {
+    const Time localtime = tick * 0.001;
+    for (; arrival != arrivals.end() and arrival->first <= localtime; arrival++)
+      control.registerMessage(localtime, arrival->second / 60.0,
+                              arrival->second);
+    while (const auto message = control.pull(localtime))
+      released[*message] = localtime;
+  }
+
+  // Everything gets out, and after warming up, in about the 95th percentile
+  // of transit time: the late ones don't hold the rest back.
+  Time total = 0;
+  for (size_t i = 0; i < released.size(); i++) {
+    ASSERT_GE(released[i], 0);
+    if (i >= 300) total += released[i] - i / 60.0;
+  }
+  const Time average = total / (released.size() - 300);
+  EXPECT_GT(average, 0.035);
+  EXPECT_LT(average, 0.06);
+
+  // Only the outliers, and a few on the edge of the percentile, are late.
+  const sky::FlowStats &stats = control.getStats();
+  EXPECT_EQ(stats.arrivals, offsets.size());
+  EXPECT_GE(stats.underruns, offsets.size() / 40);
+  EXPECT_LT(stats.underruns, offsets.size() / 10);
+  EXPECT_GT(stats.avoided, offsets.size() / 2);
+}
 
-  size_t i = 0;
-  for (auto offset : offsets) {
-    const Time localtime = i * 15;
-    control.registerMessage(localtime, localtime + offsets[offset], i);
-    // etc
+/**
+ * Messages that arrive after they're due are released ahead of those still
+ * held back.
+ */
+TEST_F(FlowTest, SkipAhead) {
+  for (size_t i = 0; i < 100; i++) {
+    control.registerMessage(i + 0.1 + (i % 2) * 0.05, i, i);
+    while (control.pull(i + 0.2)) { }
   }
+
+  // Message 101 is held back, 100 comes in behind it and is already late.
+  control.registerMessage(101.1, 101, 101);
+  EXPECT_FALSE(control.pull(101.1));
+  control.registerMessage(101.1, 100, 100);
+  EXPECT_EQ(*control.pull(101.1), 100);
+  EXPECT_FALSE(control.pull(101.1));
+  EXPECT_EQ(*control.pull(101.2), 101);
+}
+
+/**
+ * Release policies can be swapped out.
+ */
+TEST_F(FlowTest, Policies) {
+  sky::FlowControl<size_t> immediate(std::make_unique<sky::ImmediatePolicy>());
+  sky::FlowControl<size_t> margin(std::make_unique<sky::MarginPolicy>());
+  for (size_t i = 0; i < 100; i++) {
+    const Time arrival = i + 0.1 + (i % 2) * 0.05;
+    immediate.registerMessage(arrival, i, i);
+    margin.registerMessage(arrival, i, i);
+
+    EXPECT_EQ(*immediate.pull(arrival), i);
+
+    // The margin holds back the least delayed, once it has a few samples.
+    const auto early = margin.pull(arrival), late = margin.pull(i + 0.2);
+    if (i < 20) continue;
+    EXPECT_TRUE(i % 2 == 1 or !early);
+    ASSERT_TRUE(early or late);
+    EXPECT_EQ(early ? *early : *late, i);
+  }
+
+  EXPECT_FALSE(immediate.getStats().avoided);
+  EXPECT_GT(margin.getStats().avoided, 40);
 }
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "server/engine/skyinterest.hpp"
+
+/**
+ * SkyInterest filters state updates by what each client can see.
+ */
+class InterestTest: public testing::Test {
+ public:
+  sky::Arena arena;
+  sky::Map nullMap;
+  sky::Sky sky;
+  SkyInterest interest;
+  sky::SkySequence sequence;
+
+  InterestTest() :
+      arena(sky::ArenaInit("special arena", "NULL", sky::ArenaMode::Lobby), {}, true),
+      nullMap(),
+      sky(arena, nullMap, sky::SkyInit(), nullptr),
+      sequence(0) {
+    // At this viewscale the view is 800x450, half of the 1600x900 map.
+    sky.changeSettings(sky::SkySettingsDelta::ChangeView(2));
+    sky.collectDelta();
+
+    arena.connectPlayer("viewer");
+    arena.connectPlayer("other");
+    place(0, {400, 225});
+  }
+
+  // The view of player 0 is centered on (400, 225); things enter it within
+  // 1000 on the x axis and leave it beyond 1200.
+  void place(const PID pid, const sf::Vector2f &pos) {
+    sky.getParticipation(*arena.getPlayer(pid)).spawn({}, pos, 0);
+  }
+
+  // A delta that only moves the planes and entity 0 around.
+  sky::SkyDelta stateDelta(const sf::Vector2f &entityPos) {
+    sky::SkyDelta delta;
+    for (const PID pid : {PID(0), PID(1)}) {
+      const auto &plane = sky.getParticipation(*arena.getPlayer(pid)).plane;
+      delta.participations[pid].state = plane->getState();
+    }
+    sky::EntityDelta entity;
+    entity.physical.pos = entityPos;
+    delta.entities.emplace();
+    delta.entities->second.emplace(0, entity);
+    return delta;
+  }
+
+  SkyView view(const sky::SkyDelta &delta,
+               const optional<sky::SkySequence> &baseline = {}) {
+    return interest.view(sky, *arena.getPlayer(0), ++sequence, baseline,
+                         delta);
+  }
+
+  // Views of a delta until the next refresh, which lets everything through.
+  std::vector<SkyView> views(const sky::SkyDelta &delta) {
+    std::vector<SkyView> result;
+    for (size_t i = 0; i < SkyInterest::refreshInterval; i++)
+      result.push_back(view(delta));
+    return result;
+  }
+
+};
+
+/**
+ * Things in the view go through, things outside of it only on refreshes.
+ */
+TEST_F(InterestTest, Range) {
+  place(1, {700, 225});
+  for (const auto &view : views(stateDelta({700, 225}))) {
+    EXPECT_TRUE(view.hiddenPlanes.empty());
+    EXPECT_TRUE(view.hiddenEntities.empty());
+  }
+
+  place(1, {1500, 225});
+  const auto farViews = views(stateDelta({1500, 225}));
+  EXPECT_TRUE(farViews[0].hiddenPlanes.empty());
+  EXPECT_TRUE(farViews[0].hiddenEntities.empty());
+  for (size_t i = 1; i < farViews.size(); i++) {
+    EXPECT_EQ(farViews[i].hiddenPlanes, std::set<PID>({1}));
+    EXPECT_EQ(farViews[i].hiddenEntities, std::set<PID>({0}));
+  }
+
+  // Hidden entities stay in the delta, just without a change.
+  const auto delta = stateDelta({1500, 225});
+  const auto filtered = farViews[1].apply(delta);
+  EXPECT_EQ(filtered.participations.count(1), 0);
+  EXPECT_EQ(filtered.participations.count(0), 1);
+  ASSERT_EQ(filtered.entities->second.count(0), 1);
+  EXPECT_FALSE(filtered.entities->second.at(0));
+}
+
+/**
+ * Entering interest takes more than staying in it, and planes that come back
+ * into interest can't be sent relative to a baseline that left them out.
+ */
+TEST_F(InterestTest, EnterAndLeave) {
+  place(1, {1100, 225});
+  view(stateDelta({1100, 225})); // refresh
+
+  // Between the margins, but never entered.
+  auto between = view(stateDelta({1100, 225}));
+  EXPECT_EQ(between.hiddenPlanes, std::set<PID>({1}));
+  EXPECT_EQ(between.hiddenEntities, std::set<PID>({0}));
+
+  // Entering.
+  place(1, {900, 225});
+  const sky::SkySequence entered = sequence + 1;
+  auto inside = view(stateDelta({900, 225}), entered - 1);
+  EXPECT_TRUE(inside.hiddenPlanes.empty());
+  EXPECT_TRUE(inside.hiddenEntities.empty());
+  EXPECT_EQ(inside.fullPlanes, std::set<PID>({1}));
+
+  // Between the margins, after having entered; once the client acknowledges
+  // a delta with the plane in it, it can be sent relative to that.
+  place(1, {1100, 225});
+  between = view(stateDelta({1100, 225}), entered);
+  EXPECT_TRUE(between.hiddenPlanes.empty());
+  EXPECT_TRUE(between.hiddenEntities.empty());
+  EXPECT_TRUE(between.fullPlanes.empty());
+
+  // Leaving.
+  place(1, {1300, 225});
+  auto outside = view(stateDelta({1300, 225}), entered);
+  EXPECT_EQ(outside.hiddenPlanes, std::set<PID>({1}));
+  EXPECT_EQ(outside.hiddenEntities, std::set<PID>({0}));
+
+  // Coming back between the margins doesn't bring it back.
+  place(1, {1100, 225});
+  between = view(stateDelta({1100, 225}), entered);
+  EXPECT_EQ(between.hiddenPlanes, std::set<PID>({1}));
+  EXPECT_EQ(between.hiddenEntities, std::set<PID>({0}));
+}
+
+/**
+ * The client's own plane is never left out, wherever the others are.
+ */
+TEST_F(InterestTest, OwnPlane) {
+  place(1, {1500, 225});
+  for (const auto &view : views(stateDelta({1500, 225}))) {
+    EXPECT_EQ(view.hiddenPlanes.count(0), 0);
+    EXPECT_EQ(view.fullPlanes.count(0), 0);
+  }
+
+  // Without a plane there's no view to center, so everything is relevant.
+  sky.getParticipation(*arena.getPlayer(0)).suicide();
+  sky::SkyDelta delta;
+  delta.participations[1].state =
+      sky.getParticipation(*arena.getPlayer(1)).plane->getState();
+  for (const auto &view : views(delta))
+    EXPECT_TRUE(view.hiddenPlanes.empty());
+}
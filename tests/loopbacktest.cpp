@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+#include "util/loopback.hpp"
+#include "util/networkthread.hpp"
+
+/**
+ * LoopbackTransport lets hosts talk in memory, on a virtual clock. (Times
+ * here are exact in binary, so deliveries fall due exactly.)
+ */
+class LoopbackTest: public testing::Test {
+ public:
+  tg::LoopbackNetwork network;
+  tg::Host server, client;
+  tg::Telegraph<std::string> telegraph;
+  ENetPeer *serverPeer, *clientPeer;
+  ENetEvent event;
+
+  LoopbackTest() :
+      network(0.0625f),
+      server(std::make_unique<tg::LoopbackTransport>(network, 4242)),
+      client(std::make_unique<tg::LoopbackTransport>(network)) {
+    serverPeer = client.connect("localhost", 4242);
+    network.advance(0.0625f);
+    event = client.poll();
+    EXPECT_EQ(event.type, ENET_EVENT_TYPE_CONNECT);
+    event = server.poll();
+    EXPECT_EQ(event.type, ENET_EVENT_TYPE_CONNECT);
+    clientPeer = event.peer;
+  }
+
+  std::vector<std::string> receiveAll(tg::Host &host) {
+    std::vector<std::string> received;
+    for (event = host.poll(); event.type == ENET_EVENT_TYPE_RECEIVE;
+         event = host.poll()) {
+      telegraph.receive(event.packet, [&](std::string &&message) {
+        received.push_back(std::move(message));
+      });
+      enet_packet_destroy(event.packet);
+    }
+    return received;
+  }
+};
+
+/**
+ * Messages arrive in order, exactly when the latency has passed.
+ */
+TEST_F(LoopbackTest, Delivery) {
+  tg::Outbox outbox;
+  telegraph.post(outbox, clientPeer, std::string("one"));
+  telegraph.post(outbox, clientPeer, std::string("two"));
+  outbox.flush(server);
+  telegraph.transmit(server, clientPeer, std::string("three"));
+  server.flush();
+
+  network.advance(0.03125f);
+  EXPECT_TRUE(receiveAll(client).empty());
+  network.advance(0.03125f);
+  EXPECT_EQ(receiveAll(client),
+            std::vector<std::string>({"one", "two", "three"}));
+
+  // Peer telemetry works as with ENet.
+  EXPECT_EQ(client.peerStats(serverPeer)->packetsReceived, 2u);
+  EXPECT_FLOAT_EQ(client.peerStats(serverPeer)->rtt, 0.125f);
+}
+
+/**
+ * Messages to several peers go out in one packet they share, and each peer
+ * gets its own messages in order with them.
+ */
+TEST_F(LoopbackTest, SharedDatagrams) {
+  tg::Host other(std::make_unique<tg::LoopbackTransport>(network));
+  other.connect("localhost", 4242);
+  network.advance(0.0625f);
+  EXPECT_EQ(other.poll().type, ENET_EVENT_TYPE_CONNECT);
+  EXPECT_EQ(server.poll().type, ENET_EVENT_TYPE_CONNECT);
+  const std::vector<ENetPeer *> peers = server.getPeers();
+  ASSERT_EQ(peers.size(), 2u);
+  const auto everyone = [&](std::function<void(ENetPeer *const)> f) {
+    for (const auto peer : peers) f(peer);
+  };
+
+  tg::Outbox outbox;
+  telegraph.post(outbox, everyone, std::string("one"));
+  telegraph.post(outbox, everyone, std::string("two"));
+  telegraph.post(outbox, clientPeer, std::string("yours"));
+  telegraph.post(outbox, everyone, std::string("three"));
+  outbox.flush(server);
+  server.flush();
+  EXPECT_EQ(outbox.messagesFlushed, 7u);
+  EXPECT_EQ(outbox.datagramsFlushed, 3u);
+  EXPECT_EQ(server.peerStats(clientPeer)->packetsSent, 3u);
+
+  network.advance(0.0625f);
+  EXPECT_EQ(receiveAll(client),
+            std::vector<std::string>({"one", "two", "yours", "three"}));
+  EXPECT_EQ(receiveAll(other),
+            std::vector<std::string>({"one", "two", "three"}));
+
+  // Peers that went away don't hold on to anything.
+  telegraph.post(outbox, everyone, std::string("four"));
+  outbox.drop(clientPeer);
+  outbox.flush(server);
+  server.flush();
+  network.advance(0.0625f);
+  EXPECT_EQ(receiveAll(other), std::vector<std::string>({"four"}));
+}
+
+/**
+ * Disconnections reach both sides, and nothing gets through afterwards.
+ */
+TEST_F(LoopbackTest, Disconnect) {
+  client.disconnect(serverPeer);
+  telegraph.transmit(client, serverPeer, std::string("too late"));
+  client.flush();
+  network.advance(0.0625f);
+
+  event = server.poll();
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_DISCONNECT);
+  EXPECT_EQ(event.peer, clientPeer);
+  event = client.poll();
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_DISCONNECT);
+  EXPECT_TRUE(server.getPeers().empty());
+  EXPECT_TRUE(receiveAll(server).empty());
+
+  // Nobody listens on this port.
+  client.connect("localhost", 4343);
+  network.advance(0.0625f);
+  EXPECT_EQ(client.poll().type, ENET_EVENT_TYPE_DISCONNECT);
+}
+
+/**
+ * A transport going away disconnects its peers.
+ */
+TEST_F(LoopbackTest, Teardown) {
+  {
+    tg::Host other(std::make_unique<tg::LoopbackTransport>(network));
+    other.connect("localhost", 4242);
+    network.advance(0.0625f);
+    EXPECT_EQ(server.poll().type, ENET_EVENT_TYPE_CONNECT);
+    telegraph.transmit(server, server.getPeers().back(), std::string("hi"));
+    server.flush();
+  }
+  network.advance(0.0625f);
+  EXPECT_EQ(server.poll().type, ENET_EVENT_TYPE_DISCONNECT);
+  EXPECT_EQ(server.getPeers().size(), 1u);
+}
+
+/**
+ * A NetworkThread decodes what comes in and flushes the Outboxes it's
+ * handed; pumped by hand, it runs like a host serviced inline.
+ */
+TEST_F(LoopbackTest, NetworkThread) {
+  tg::NetworkThread<std::string> threaded(
+      std::make_unique<tg::LoopbackTransport>(network, 4343), 2);
+  tg::Host other(std::make_unique<tg::LoopbackTransport>(network));
+  ENetPeer *threadedPeer = other.connect("localhost", 4343);
+  network.advance(0.0625f);
+  EXPECT_EQ(other.poll().type, ENET_EVENT_TYPE_CONNECT);
+  threaded.pump(0);
+
+  std::vector<tg::NetworkEvent<std::string>> events;
+  const auto receiveEvents = [&]() {
+    threaded.receive([&](tg::NetworkEvent<std::string> &&event) {
+      events.push_back(std::move(event));
+    });
+  };
+  receiveEvents();
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, ENET_EVENT_TYPE_CONNECT);
+  ENetPeer *otherPeer = events[0].peer;
+  events.clear();
+
+  // More messages than the queue holds: they wait for us.
+  tg::Outbox outbox;
+  for (const auto message : {"one", "two", "three"})
+    telegraph.post(outbox, threadedPeer, std::string(message));
+  outbox.flush(other);
+  other.flush();
+  network.advance(0.0625f);
+  threaded.pump(0);
+  receiveEvents();
+  threaded.pump(0);
+  receiveEvents();
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0].type, ENET_EVENT_TYPE_RECEIVE);
+  EXPECT_EQ(events[0].message.get(), "one");
+  EXPECT_EQ(events[2].message.get(), "three");
+  EXPECT_EQ(events[2].size, telegraph.encode(std::string("three")).size());
+
+  // Replies go out on the next pump.
+  telegraph.post(outbox, otherPeer, std::string("reply"));
+  threaded.send(outbox.take());
+  threaded.pump(0);
+  network.advance(0.0625f);
+  EXPECT_EQ(receiveAll(other), std::vector<std::string>({"reply"}));
+  EXPECT_EQ(threaded.getHost().peerStats(otherPeer)->packetsSent, 1u);
+}
+
+/**
+ * Outboxes the game thread filled before it heard of a disconnection don't
+ * go to the peer, even once it's been reused for a new connection.
+ */
+TEST_F(LoopbackTest, NetworkThreadReconnect) {
+  tg::NetworkThread<std::string> threaded(
+      std::make_unique<tg::LoopbackTransport>(network, 4343));
+  std::vector<tg::NetworkEvent<std::string>> events;
+  const auto receiveEvents = [&]() {
+    events.clear();
+    threaded.receive([&](tg::NetworkEvent<std::string> &&event) {
+      events.push_back(std::move(event));
+    });
+  };
+
+  tg::Host first(std::make_unique<tg::LoopbackTransport>(network));
+  ENetPeer *firstPeer = first.connect("localhost", 4343);
+  network.advance(0.0625f);
+  EXPECT_EQ(first.poll().type, ENET_EVENT_TYPE_CONNECT);
+  threaded.pump(0);
+  receiveEvents();
+  ASSERT_EQ(events.size(), 1u);
+  ENetPeer *peer = events[0].peer;
+
+  // Within one tick of the game thread, the client leaves and another one
+  // comes in on the same peer.
+  first.disconnect(firstPeer);
+  network.advance(0.0625f);
+  threaded.pump(0);
+  tg::Host second(std::make_unique<tg::LoopbackTransport>(network));
+  second.connect("localhost", 4343);
+  network.advance(0.0625f);
+  EXPECT_EQ(second.poll().type, ENET_EVENT_TYPE_CONNECT);
+  threaded.pump(0);
+
+  // What the game thread sent to the first client is dropped.
+  tg::Outbox outbox;
+  telegraph.post(outbox, peer, std::string("for the first"));
+  threaded.send(outbox.take());
+  threaded.pump(0);
+
+  receiveEvents();
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].type, ENET_EVENT_TYPE_DISCONNECT);
+  EXPECT_EQ(events[1].type, ENET_EVENT_TYPE_CONNECT);
+  EXPECT_EQ(events[1].peer, peer);
+
+  // Once it has heard, it can talk to the second.
+  telegraph.post(outbox, peer, std::string("for the second"));
+  threaded.send(outbox.take());
+  threaded.pump(0);
+  network.advance(0.0625f);
+  EXPECT_EQ(receiveAll(second),
+            std::vector<std::string>({"for the second"}));
+}
+
+/**
+ * The game thread sleeps until events come in, or until it's due to send.
+ */
+TEST_F(LoopbackTest, NetworkThreadWait) {
+  using Clock = std::chrono::steady_clock;
+  tg::NetworkThread<std::string> threaded(
+      std::make_unique<tg::LoopbackTransport>(network, 4343));
+
+  // Nothing came in: we sleep until the deadline.
+  auto start = Clock::now();
+  threaded.wait(start + std::chrono::milliseconds(20));
+  EXPECT_TRUE(Clock::now() - start >= std::chrono::milliseconds(20));
+
+  // An event came in: we don't sleep at all.
+  tg::Host other(std::make_unique<tg::LoopbackTransport>(network));
+  other.connect("localhost", 4343);
+  network.advance(0.0625f);
+  threaded.pump(0);
+  start = Clock::now();
+  threaded.wait(start + std::chrono::seconds(10));
+  EXPECT_TRUE(Clock::now() - start < std::chrono::seconds(5));
+
+  size_t events = 0;
+  threaded.receive([&](tg::NetworkEvent<std::string> &&) { events++; });
+  EXPECT_EQ(events, 1u);
+}
@@ -1,5 +1,6 @@
 #include "engine/protocol.hpp"
 #include "engine/sky/sky.hpp"
+#include "engine/sky/snapshothistory.hpp"
 #include "util/methods.hpp"
 #include "util/printer.hpp"
 #include <gtest/gtest.h>
@@ -55,6 +56,15 @@ TEST_F(ProtocolTest, CerealProtocol) {
     EXPECT_EQ(packet.stringData.get(), "hey");
   }
 
+  {
+    output(sky::ClientPacket::Pong(1, 2, 0.15f));
+    sky::ClientPacket packet;
+    input(packet);
+    EXPECT_EQ(packet.verifyStructure(), true);
+    EXPECT_EQ(packet.type, sky::ClientPacket::Type::Pong);
+    EXPECT_EQ(packet.viewDelay.get(), 0.15f);
+  }
+
   {
     output(sky::ClientPacket::ReqSpawn());
     sky::ClientPacket packet;
@@ -64,6 +74,192 @@ TEST_F(ProtocolTest, CerealProtocol) {
   }
 }
 
+/**
+ * Plane states can be transmitted in a compact, quantized form.
+ */
+TEST_F(ProtocolTest, CompactPlaneState) {
+  const sf::Vector2f dims(1600, 900);
+  sky::PlaneState state(sky::PlaneTuning(), {123.4f, 567.8f}, 42);
+  state.physical.rotvel = -190;
+  state.leftoverVel = {12, -34};
+  state.energy = 0.3;
+  state.stalled = true;
+
+  // Lossless encoding reproduces the state exactly.
+  {
+    output(sky::CompactPlaneState(
+        state, sky::PlaneStateEncoding::Lossless(), dims));
+    sky::CompactPlaneState compact;
+    input(compact);
+    const sky::PlaneState decoded = compact.decode(dims);
+    EXPECT_EQ(decoded.physical.pos, state.physical.pos);
+    EXPECT_EQ(decoded.physical.vel, state.physical.vel);
+    EXPECT_EQ(float(decoded.physical.rot), float(state.physical.rot));
+    EXPECT_EQ(decoded.leftoverVel, state.leftoverVel);
+    EXPECT_EQ(float(decoded.energy), float(state.energy));
+  }
+
+  // The default encoding is much smaller, and accurate enough.
+  {
+    stream.str("");
+    output(sky::PlaneStateClient(state).physical);
+    const auto fullSize = stream.str().size();
+    stream.str("");
+
+    output(sky::CompactPlaneState(state, sky::PlaneStateEncoding(), dims));
+    EXPECT_LT(stream.str().size(), fullSize);
+    sky::CompactPlaneState compact;
+    input(compact);
+    const sky::PlaneState decoded = compact.decode(dims);
+    EXPECT_NEAR(decoded.physical.pos.x, state.physical.pos.x, 0.1);
+    EXPECT_NEAR(decoded.physical.pos.y, state.physical.pos.y, 0.1);
+    EXPECT_NEAR(decoded.physical.vel.x, state.physical.vel.x, 0.1);
+    EXPECT_NEAR(decoded.physical.rot, state.physical.rot, 0.01);
+    EXPECT_NEAR(decoded.physical.rotvel, state.physical.rotvel, 0.05);
+    EXPECT_NEAR(decoded.energy, state.energy, 0.01);
+    EXPECT_EQ(decoded.stalled, true);
+  }
+
+  // Precision is selectable per field group.
+  {
+    sky::PlaneStateEncoding encoding;
+    encoding.position = Precision::Full;
+    output(sky::CompactPlaneState(state, encoding, dims));
+    sky::CompactPlaneState compact;
+    input(compact);
+    EXPECT_EQ(compact.encoding, encoding);
+    EXPECT_EQ(compact.decode(dims).physical.pos, state.physical.pos);
+  }
+
+  // Controls are packed into bits.
+  {
+    stream.str("");
+    sky::PlaneControls controls;
+    controls.doAction(sky::Action::Left, true);
+    controls.doAction(sky::Action::Primary, true);
+    output(controls);
+    EXPECT_LE(stream.str().size(), 2u);
+    sky::PlaneControls decoded;
+    input(decoded);
+    EXPECT_EQ(decoded, controls);
+  }
+}
+
+/**
+ * Sky deltas can be sent relative to a baseline the client acknowledged,
+ * carrying only the plane state fields that changed.
+ */
+TEST_F(ProtocolTest, RelativeDelta) {
+  const sf::Vector2f dims(1600, 900);
+  const sky::PlaneStateEncoding encoding;
+  sky::PlaneState state(sky::PlaneTuning(), {123.4f, 567.8f}, 42);
+  state.physical.vel = {100, 0};
+
+  sky::SkyDelta baseDelta;
+  baseDelta.participations[0].compactState.emplace(state, encoding, dims);
+  sky::SnapshotHistory serverHistory(4), clientHistory(4);
+  serverHistory.record(0, baseDelta);
+  clientHistory.record(0, baseDelta);
+
+  // The plane glides along; only its position changed.
+  state.physical.pos.x += 2;
+  sky::SkyDelta delta;
+  delta.participations[0].compactState.emplace(state, encoding, dims);
+
+  output(delta);
+  const auto fullSize = stream.str().size();
+  stream.str("");
+
+  ASSERT_TRUE(bool(serverHistory.find(0)));
+  output(sky::SnapshotHistory::relativeTo(delta, *serverHistory.find(0)));
+  EXPECT_LT(stream.str().size(), fullSize);
+
+  // The client rebuilds the full state from its copy of the baseline.
+  sky::SkyDelta received;
+  input(received);
+  ASSERT_TRUE(bool(clientHistory.find(0)));
+  ASSERT_TRUE(sky::SnapshotHistory::rebuild(received, *clientHistory.find(0)));
+  const auto &compact = received.participations[0].compactState.get();
+  EXPECT_TRUE(compact.isComplete());
+  const sky::PlaneState decoded = compact.decode(dims);
+  EXPECT_NEAR(decoded.physical.pos.x, state.physical.pos.x, 0.1);
+  EXPECT_NEAR(decoded.physical.vel.x, state.physical.vel.x, 0.1);
+
+  // Without the baseline, a relative delta can't be rebuilt.
+  sky::SkyDelta orphan =
+      sky::SnapshotHistory::relativeTo(delta, *serverHistory.find(0));
+  EXPECT_FALSE(sky::SnapshotHistory::rebuild(orphan, sky::SkySnapshot()));
+}
+
+/**
+ * Packets are delivered with a reliability class that fits what they carry.
+ */
+TEST_F(ProtocolTest, Reliability) {
+  using tg::Reliability;
+  EXPECT_EQ(reliabilityOf(sky::ServerPacket::Ping(0)),
+            Reliability::Unsequenced);
+  EXPECT_EQ(reliabilityOf(sky::ServerPacket::Chat(0, "hi")),
+            Reliability::ReliableOrdered);
+
+  // Plain state updates can be lost, events can't.
+  sky::SkyDelta delta;
+  delta.participations[0].compactState.emplace();
+  EXPECT_FALSE(delta.carriesEvents());
+  EXPECT_EQ(reliabilityOf(sky::ServerPacket::DeltaSky(delta, 0, 0)),
+            Reliability::UnreliableSequenced);
+
+  delta.participations[1].kill = true;
+  EXPECT_TRUE(delta.carriesEvents());
+  EXPECT_EQ(reliabilityOf(sky::ServerPacket::DeltaSky(delta, 0, 0)),
+            Reliability::ReliableOrdered);
+
+  // Stale deltas keep their events.
+  delta.dropState();
+  EXPECT_EQ(delta.participations.size(), 1u);
+  EXPECT_EQ(delta.participations.count(1), 1u);
+
+  // Inputs are never reliable: control changes are repeated instead.
+  sky::ParticipationInput input;
+  input.controls.emplace();
+  EXPECT_EQ(reliabilityOf(sky::ClientPacket::ReqInput({{0, 0, input}})),
+            Reliability::UnreliableSequenced);
+}
+
+/**
+ * Control changes are repeated in the next few inputs of an InputStream,
+ * and an InputFilter passes each input on once.
+ */
+TEST_F(ProtocolTest, InputRedundancy) {
+  sky::InputStream stream(2);
+  sky::InputFilter filter;
+
+  sky::ParticipationInput change, state;
+  change.controls.emplace();
+  state.planeState.emplace();
+
+  const auto first = stream.push(change, 0);
+  ASSERT_EQ(first.size(), 1u);
+  EXPECT_TRUE(filter.accept(first[0]));
+
+  // Suppose the second packet is lost; the change still gets through twice.
+  stream.push(state, 1);
+  const auto third = stream.push(state, 2);
+  ASSERT_EQ(third.size(), 2u);
+  EXPECT_EQ(third[0].sequence, 0u);
+  EXPECT_TRUE(bool(third[0].input.controls));
+  EXPECT_FALSE(bool(third[0].input.planeState));
+  EXPECT_EQ(third[1].sequence, 2u);
+  EXPECT_FALSE(filter.accept(third[0]));
+  EXPECT_TRUE(filter.accept(third[1]));
+  EXPECT_TRUE(verifyValue(sky::ClientPacket::ReqInput(third)));
+
+  // After that, it's not repeated anymore.
+  EXPECT_EQ(stream.push(state, 3).size(), 1u);
+
+  // An empty ReqInput is malformed.
+  EXPECT_FALSE(verifyValue(sky::ClientPacket::ReqInput({})));
+}
+
 /**
  * Invariant violations can be caught in protocol packets.
  */
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "engine/sky/sky.hpp"
+#include "engine/sky/interpolation.hpp"
+#include "engine/sky/statehistory.hpp"
 
 /**
  * The Sky subsystem operates and networks correctly.
@@ -187,6 +189,233 @@ TEST_F(SkyTest, AuthorityTest) {
 
 }
 
+/**
+ * Clients respect their own authority when applying a SkyDelta that is shared
+ * between all clients.
+ */
+TEST_F(SkyTest, SharedDeltaTest) {
+  arena.connectPlayer("nameless plane");
+  arena.connectPlayer("other plane");
+  auto &player = *arena.getPlayer(0);
+  auto &otherPlayer = *arena.getPlayer(1);
+  sky.getParticipation(player).spawn({}, {200, 200}, 0);
+  sky.getParticipation(otherPlayer).spawn({}, {200, 200}, 0);
+
+  sky::Arena remoteArena{arena.captureInitializer(), PID(0)};
+  sky::Sky remoteSky{remoteArena, nullMap, sky.captureInitializer()};
+  auto &remoteParticip = remoteSky.getParticipation(*remoteArena.getPlayer(0));
+  auto &remoteOther = remoteSky.getParticipation(*remoteArena.getPlayer(1));
+
+  // Both planes move on the server, and the server drains our energy.
+  for (auto *p : {&player, &otherPlayer}) {
+    sky::ParticipationInput input;
+    sky::PlaneStateClient stateInput(sky.getParticipation(*p).plane->getState());
+    stateInput.physical = sky::PhysicalState({300, 300}, {}, 50, 0);
+    input.planeState.emplace(stateInput);
+    sky.getParticipation(*p).applyInput(input);
+  }
+  ASSERT_TRUE(sky.getParticipation(player).plane->requestDiscreteEnergy(0.5));
+
+  const auto delta = sky.collectDelta();
+  ASSERT_TRUE(bool(delta));
+  remoteSky.applyDelta(delta.get());
+
+  // Our position is ours, the energy is the server's.
+  EXPECT_EQ(remoteParticip.plane->getState().physical.pos.x, 200);
+  EXPECT_EQ(float(remoteParticip.plane->getState().energy), 0.5);
+  // Other planes are the server's entirely.
+  EXPECT_EQ(remoteOther.plane->getState().physical.pos.x, 300);
+}
+
+/**
+ * A reliable delta that arrives after a newer one only brings its events:
+ * control changes still apply, states and overtaken spawns and kills don't.
+ */
+TEST_F(SkyTest, OvertakenDeltaTest) {
+  arena.connectPlayer("nameless plane");
+  arena.connectPlayer("other plane");
+  auto &other = sky.getParticipation(*arena.getPlayer(1));
+  other.spawn({}, {200, 200}, 0);
+
+  sky::Arena remoteArena{arena.captureInitializer(), PID(0)};
+  sky::Sky remoteSky{remoteArena, nullMap, sky.captureInitializer()};
+  auto &remoteOther = remoteSky.getParticipation(*remoteArena.getPlayer(1));
+
+  const auto move = [&](const float x, const bool left) {
+    sky::ParticipationInput input;
+    sky::PlaneStateClient stateInput(other.plane->getState());
+    stateInput.physical = sky::PhysicalState({x, 200}, {}, 0, 0);
+    input.planeState.emplace(stateInput);
+    sky::PlaneControls controls(other.getControls());
+    controls.doAction(sky::Action::Left, left);
+    input.controls = controls;
+    other.applyInput(input);
+    return sky.collectDelta().get();
+  };
+
+  // The control change goes out reliably, the next state doesn't.
+  auto early = move(300, true);
+  const auto late = move(400, true);
+  ASSERT_TRUE(early.carriesEvents());
+  ASSERT_FALSE(late.carriesEvents());
+
+  remoteSky.applyDelta(late);
+  early.dropState();
+  remoteSky.applyDelta(early);
+  EXPECT_EQ(remoteOther.plane->getState().physical.pos.x, 400);
+  EXPECT_TRUE(remoteOther.getControls().getState<sky::Action::Left>());
+
+  // A kill overtaken by a respawn doesn't kill the new life.
+  other.suicide();
+  auto kill = sky.collectDelta().get();
+  other.spawn({}, {500, 200}, 0);
+  const auto spawn = sky.collectDelta().get();
+  ASSERT_TRUE(kill.participations.at(1).kill);
+
+  remoteSky.applyDelta(spawn);
+  kill.dropState({1});
+  remoteSky.applyDelta(kill);
+  ASSERT_TRUE(remoteOther.isSpawned());
+  EXPECT_EQ(remoteOther.plane->getState().physical.pos.x, 500);
+}
+
+/**
+ * A client reconciles its plane with the server's state by replaying what it
+ * predicted since the input the server acknowledged, instead of snapping back.
+ */
+TEST_F(SkyTest, ReconciliationTest) {
+  arena.connectPlayer("nameless plane");
+  auto &player = *arena.getPlayer(0);
+  auto &participation = sky.getParticipation(player);
+  participation.spawn({}, {200, 200}, 0);
+  ASSERT_TRUE(bool(sky.collectDelta()));
+
+  sky::Arena remoteArena{arena.captureInitializer(), PID(0)};
+  sky::Sky remoteSky{remoteArena, nullMap, sky.captureInitializer()};
+  auto &remoteParticip = remoteSky.getParticipation(*remoteArena.getPlayer(0));
+
+  // We send an input, then another that spends energy at once.
+  remoteParticip.predictInput(0);
+  remoteArena.tick(0.1);
+  remoteParticip.predictInput(1);
+  ASSERT_TRUE(remoteParticip.plane->requestDiscreteEnergy(0.5));
+
+  // The server applies the first, and drains energy we didn't predict.
+  participation.applyInput(sky::SequencedInput(0, 0, {}));
+  arena.tick(0.1);
+  ASSERT_TRUE(participation.plane->requestDiscreteEnergy(0.2));
+
+  // We keep our unacknowledged spending, and take the server's drain.
+  {
+    const float before = remoteParticip.plane->getState().energy;
+    const auto delta = sky.collectDelta();
+    ASSERT_TRUE(bool(delta));
+    remoteSky.applyDelta(delta.get());
+    EXPECT_NEAR(float(remoteParticip.plane->getState().energy),
+                before - 0.2f, 0.0001f);
+  }
+
+  // Once the server catches up with the second, there's nothing to correct.
+  participation.applyInput(sky::SequencedInput(1, 0.1, {}));
+  ASSERT_TRUE(participation.plane->requestDiscreteEnergy(0.5));
+  arena.tick(0.1);
+  remoteArena.tick(0.1);
+  {
+    const float before = remoteParticip.plane->getState().energy;
+    const auto delta = sky.collectDelta();
+    ASSERT_TRUE(bool(delta));
+    remoteSky.applyDelta(delta.get());
+    EXPECT_NEAR(float(remoteParticip.plane->getState().energy),
+                before, 0.0001f);
+  }
+}
+
+/**
+ * Remote planes' states are interpolated between snapshots, some delay behind
+ * the server, and extrapolated only so far past the last one.
+ */
+TEST_F(SkyTest, InterpolationTest) {
+  sky::InterpolationBuffer buffer(8, 0.1);
+  ASSERT_FALSE(bool(buffer.sample(0, 0, 0)));
+
+  // Snapshots from server times 0 and 1 are released at local times 10 and 11.
+  buffer.record(10, 0, 0, sky::PhysicalState({0, 0}, {100, 0}, 350, 0));
+  buffer.record(11, 1, 0, sky::PhysicalState({100, 0}, {100, 0}, 10, 0));
+
+  // Half a second behind, we're halfway between them, turning the short way.
+  {
+    const auto state = buffer.sample(0, 11, 0.5);
+    ASSERT_TRUE(bool(state));
+    EXPECT_NEAR(state->pos.x, 50, 0.01);
+    EXPECT_NEAR(cyclicDistance(Cyclic(0, 360, state->rot), 0), 0, 0.01);
+  }
+
+  // Past the last snapshot, the plane keeps its momentum for a while.
+  EXPECT_NEAR(buffer.sample(0, 11.05, 0)->pos.x, 105, 0.01);
+  EXPECT_NEAR(buffer.sample(0, 12, 0)->pos.x, 110, 0.01);
+
+  buffer.forget(0);
+  EXPECT_FALSE(bool(buffer.sample(0, 11, 0.5)));
+}
+
+/**
+ * Released deltas jitter, but the rendered time doesn't: it follows the least
+ * delayed ones, and never goes backwards.
+ */
+TEST_F(SkyTest, InterpolationJitterTest) {
+  sky::InterpolationBuffer buffer(8, 0.1);
+
+  // A plane at 100 units per second, with deltas at 20 Hz released up to
+  // 30 ms late, rendered at 60 Hz.
+  size_t next = 0;
+  float lastX = -1;
+  for (size_t frame = 0; frame < 300; frame++) {
+    const Time localtime = 10 + frame / 60.0;
+    for (; ; next++) {
+      const Time timestamp = next * 0.05;
+      const Time release = 10 + timestamp + (next * 7 % 4) * 0.01;
+      if (release > localtime) break;
+      buffer.record(release, timestamp, 0, sky::PhysicalState(
+          {float(100 * timestamp), 0}, {100, 0}, 0, 0));
+    }
+
+    if (const auto state = buffer.sample(0, localtime, 0.1)) {
+      EXPECT_GE(state->pos.x, lastX);
+      lastX = state->pos.x;
+    }
+  }
+
+  // The offset is the least delayed one's, so we render 0.1 s behind that.
+  EXPECT_NEAR(buffer.sample(0, 15, 0.1)->pos.x, 490, 0.5);
+}
+
+/**
+ * Plane histories rewind to past states within their depth, and hitscans
+ * judge hits against the rewound hitbox.
+ */
+TEST_F(SkyTest, StateHistoryTest) {
+  sky::PhysicalHistory history(4);
+  ASSERT_FALSE(bool(history.rewind(0)));
+
+  for (size_t i = 0; i < 6; i++)
+    history.record(i, sky::PhysicalState({100.0f * i, 0}, {}, 0, 0));
+
+  // Between records, we interpolate; past the depth, we stop at the oldest.
+  EXPECT_NEAR(history.rewind(4.5)->pos.x, 450, 0.01);
+  EXPECT_NEAR(history.rewind(0)->pos.x, 200, 0.01);
+  EXPECT_NEAR(history.rewind(10)->pos.x, 500, 0.01);
+
+  // A shot along the x axis hits the plane where it was, not where it is.
+  const auto past = history.rewind(3).get();
+  const auto present = history.rewind(5).get();
+  const sf::Vector2f hitbox(40, 20);
+  const auto hit = sky::hitscan({0, 0}, 0, 1000, past, hitbox);
+  ASSERT_TRUE(bool(hit));
+  EXPECT_NEAR(hit.get(), 280, 0.01);
+  EXPECT_FALSE(bool(sky::hitscan({0, 0}, 0, 400, present, hitbox)));
+  EXPECT_FALSE(bool(sky::hitscan({0, 0}, 90, 1000, past, hitbox)));
+}
+
 /**
  * Entities can be created and synchronized over the network.
  */
@@ -234,6 +463,50 @@ TEST_F(SkyTest, EntityTest) {
 
 }
 
+/**
+ * A client that skips deltas carrying only state, and is sent them folded
+ * into the next one, doesn't miss the removals and changes they carried.
+ */
+TEST_F(SkyTest, SkippedDeltaTest) {
+  arena.connectPlayer("nameless plane");
+  sky.getParticipation(*arena.getPlayer(0)).spawn({}, {200, 200}, 0);
+  for (const float x : {200, 300, 400})
+    sky.spawnEntity(sky::EntityState(
+        {}, {}, sky::Shape::Circle(1),
+        sf::Vector2f(x, 200), sf::Vector2f(0, 0)));
+  ASSERT_TRUE(sky.collectDelta());
+
+  sky::Arena remoteArena{arena.captureInitializer(), PID(0)};
+  sky::Sky served{remoteArena, nullMap, sky.captureInitializer()};
+  sky::Arena skippingArena{arena.captureInitializer(), PID(0)};
+  sky::Sky skipping{skippingArena, nullMap, sky.captureInitializer()};
+  ASSERT_EQ(skipping.getEntities().size(), 3);
+
+  // An entity is removed: the delta saying so only carries state.
+  (*sky.getEntities().begin()).destroy();
+  arena.tick(0.02);
+  const auto removal = sky.collectDelta();
+  ASSERT_TRUE(removal);
+  EXPECT_FALSE(removal->carriesEvents());
+
+  // The next one says nothing about the entities.
+  arena.tick(0.02);
+  const auto next = sky.collectDelta();
+  ASSERT_TRUE(next);
+  EXPECT_FALSE(next->entities);
+
+  served.applyDelta(*removal);
+  served.applyDelta(*next);
+  sky::SkyDelta caughtUp{*removal};
+  caughtUp.absorb(*next);
+  skipping.applyDelta(caughtUp);
+
+  EXPECT_EQ(served.getEntities().size(), 2);
+  EXPECT_EQ(skipping.getEntities().size(), 2);
+  EXPECT_EQ(caughtUp.participations.at(0).state->physical.pos,
+            next->participations.at(0).state->physical.pos);
+}
+
 /**
  * Tuning values can be accessed by name, for use in the rcon and sanbox.
  */
@@ -2,6 +2,22 @@
 #include "util/telegraph.hpp"
 #include "engine/protocol.hpp"
 
+/**
+ * A message that opts into compression.
+ */
+struct BigMessage {
+  std::string contents;
+
+  template<typename Archive>
+  void serialize(Archive &ar) {
+    ar(contents);
+  }
+};
+
+bool compressible(const BigMessage &) {
+  return true;
+}
+
 /**
  * The Telegraph utility helps us send and receive data.
  */
@@ -122,3 +138,193 @@ TEST_F(TelegraphTest, Invariant) {
     ASSERT_EQ(bool(packet), false);
   }
 }
+
+/**
+ * The output buffer is reused between encodes, and packets sent to a range of
+ * peers share one encoding.
+ */
+TEST_F(TelegraphTest, EncodeReuse) {
+  tg::Telegraph<std::string> telegraph;
+
+  const size_t longSize =
+      telegraph.encode(std::string("a fairly long string, to grow the buffer"))
+          .size();
+  const size_t shortSize = telegraph.encode(std::string("short")).size();
+  EXPECT_LT(shortSize, longSize);
+
+  telegraph.transmit(client, [&](auto f) { f(serverPeer); f(serverPeer); },
+                     std::string("twice"));
+  event = processHosts(server, client);
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+  EXPECT_EQ(telegraph.receive(event.packet).get(), "twice");
+  event = processHosts(server, client);
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+  EXPECT_EQ(telegraph.receive(event.packet).get(), "twice");
+}
+
+/**
+ * Unreliable packets stay unreliable when ENet fragments them.
+ */
+TEST_F(TelegraphTest, PacketFlags) {
+  EXPECT_EQ(tg::packetFlagsOf(tg::Reliability::ReliableOrdered),
+            enet_uint32(ENET_PACKET_FLAG_RELIABLE));
+  for (const auto reliability : {tg::Reliability::UnreliableSequenced,
+                                 tg::Reliability::Unsequenced}) {
+    const enet_uint32 flags = tg::packetFlagsOf(reliability);
+    EXPECT_FALSE(flags & ENET_PACKET_FLAG_RELIABLE);
+    EXPECT_TRUE(flags & ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+  }
+}
+
+/**
+ * Messages posted to an Outbox are coalesced into one datagram per peer and
+ * reliability class, and unframed on reception.
+ */
+TEST_F(TelegraphTest, Coalescing) {
+  tg::Telegraph<std::string> telegraph;
+  tg::Outbox outbox;
+
+  telegraph.post(outbox, serverPeer, std::string("one"));
+  telegraph.post(outbox, serverPeer, std::string("two"));
+  telegraph.post(outbox, serverPeer, std::string("three"));
+  outbox.flush(client);
+  EXPECT_EQ(outbox.messagesFlushed, 3u);
+  EXPECT_EQ(outbox.datagramsFlushed, 1u);
+
+  event = processHosts(server, client);
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+  std::vector<std::string> received;
+  telegraph.receive(event.packet, [&](std::string &&message) {
+    received.push_back(std::move(message));
+  });
+  EXPECT_EQ(received, std::vector<std::string>({"one", "two", "three"}));
+
+  // Large messages are split over several datagrams.
+  for (size_t i = 0; i < 4; i++)
+    telegraph.post(outbox, serverPeer, std::string(500, 'x'));
+  outbox.flush(client);
+  EXPECT_EQ(outbox.datagramsFlushed, 2u);
+}
+
+/**
+ * Outboxes filled elsewhere can be taken and appended to another one, with
+ * their datagrams going after the ones already queued; telemetry merges
+ * the same way.
+ */
+TEST_F(TelegraphTest, OutboxHandover) {
+  tg::Telegraph<std::string> telegraph, worker;
+  tg::Outbox outbox, elsewhere;
+
+  telegraph.post(outbox, serverPeer, std::string("one"));
+  worker.post(elsewhere, serverPeer, std::string("two"));
+  worker.post(elsewhere, serverPeer, std::string("three"));
+  tg::Outbox taken = elsewhere.take();
+  elsewhere.flush(client);
+  EXPECT_EQ(elsewhere.messagesFlushed, 0u);
+
+  outbox.append(std::move(taken));
+  outbox.flush(client);
+  EXPECT_EQ(outbox.messagesFlushed, 3u);
+  EXPECT_EQ(outbox.datagramsFlushed, 2u);
+
+  event = processHosts(server, client);
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+  std::vector<std::string> received;
+  telegraph.receive(event.packet, [&](std::string &&message) {
+    received.push_back(std::move(message));
+  });
+  EXPECT_EQ(received, std::vector<std::string>({"one"}));
+
+  telegraph.traffic.merge(worker.traffic);
+  EXPECT_EQ(telegraph.traffic.sent.at("message").count, 3u);
+}
+
+/**
+ * Messages that opt in are compressed above a threshold, and decompressed
+ * transparently on reception.
+ */
+TEST_F(TelegraphTest, Compression) {
+  tg::Telegraph<BigMessage> telegraph;
+  telegraph.compression.threshold = 256;
+
+  BigMessage message;
+  for (size_t i = 0; i < 100; i++)
+    message.contents += "player" + std::to_string(i % 10);
+
+  telegraph.transmit(client, serverPeer, message);
+  EXPECT_EQ(telegraph.compression.stats.frames, 1u);
+  EXPECT_LT(telegraph.compression.stats.bytesOut,
+            telegraph.compression.stats.bytesIn);
+
+  event = processHosts(server, client);
+  EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+  EXPECT_LT(event.packet->dataLength, message.contents.size());
+  EXPECT_EQ(telegraph.receive(event.packet)->contents, message.contents);
+
+  // Small messages aren't worth it.
+  telegraph.transmit(client, serverPeer, BigMessage{"short"});
+  EXPECT_EQ(telegraph.compression.stats.frames, 1u);
+}
+
+/**
+ * RateControl speeds up on a clean link and backs off under congestion.
+ */
+TEST_F(TelegraphTest, RateControl) {
+  tg::RateControl rate(1.0f / 60.0f, 1.0f / 10.0f, 1.0f / 25.0f);
+
+  // A clean link converges to the fastest rate.
+  for (size_t i = 0; i < 20; i++) rate.update(tg::LinkQuality(0.05f));
+  EXPECT_FLOAT_EQ(rate.getInterval(), 1.0f / 60.0f);
+
+  // Queueing delay and loss both back off.
+  rate.update(tg::LinkQuality(0.2f));
+  EXPECT_FLOAT_EQ(rate.getInterval(), 1.5f / 60.0f);
+  rate.update(tg::LinkQuality(0.05f, 0.1f));
+  EXPECT_FLOAT_EQ(rate.getInterval(), 2.25f / 60.0f);
+
+  // Going over the bandwidth budget backs off in proportion.
+  rate.update(tg::LinkQuality(0.05f), 4);
+  EXPECT_FLOAT_EQ(rate.getInterval(), 1.0f / 10.0f);
+
+  // Sends fall due on the interval, without bursting after a stall.
+  rate.tick(0.05f);
+  EXPECT_FALSE(rate.due());
+  rate.tick(1);
+  EXPECT_TRUE(rate.due());
+  rate.reset();
+  EXPECT_TRUE(rate.due());
+  rate.reset();
+  EXPECT_FALSE(rate.due());
+}
+
+/**
+ * Hosts keep per-peer telemetry, and Telegraphs break their traffic down by
+ * message kind.
+ */
+TEST_F(TelegraphTest, Telemetry) {
+  tg::Telegraph<sky::ClientPacket> telegraph;
+  telegraph.transmit(client, serverPeer, sky::ClientPacket::Chat("hi"));
+  telegraph.transmit(client, serverPeer, sky::ClientPacket::Chat("hello"));
+  telegraph.transmit(client, serverPeer,
+                     sky::ClientPacket::Chat(std::string(4000, 'x')));
+
+  const auto clientStats = client.peerStats(serverPeer);
+  ASSERT_TRUE(bool(clientStats));
+  EXPECT_EQ(clientStats->packetsSent, 3u);
+  EXPECT_GT(clientStats->fragmentsSent, 1u); // the big one was split
+
+  const auto &sent = telegraph.traffic.sent.at("Chat");
+  EXPECT_EQ(sent.count, 3u);
+  EXPECT_GE(sent.max, 4000u);
+
+  for (size_t i = 0; i < 3; i++) {
+    event = processHosts(server, client);
+    EXPECT_EQ(event.type, ENET_EVENT_TYPE_RECEIVE);
+    telegraph.receive(event.packet);
+  }
+  EXPECT_EQ(telegraph.traffic.received.at("Chat").count, 3u);
+  EXPECT_EQ(server.peerStats(clientPeer)->packetsReceived, 3u);
+
+  telegraph.traffic.reset();
+  EXPECT_TRUE(telegraph.traffic.sent.empty());
+}
@@ -1,5 +1,6 @@
 #include <SFML/System.hpp>
 #include <gtest/gtest.h>
+#include <atomic>
 #include "util/threads.hpp"
 #include "util/printer.hpp"
 
@@ -55,3 +56,96 @@ TEST_F(ThreadTest, BasicTest) {
 
 }
 
+
+/**
+ * ThreadPool runs every task before wait() returns, and hands back the
+ * first exception a task threw.
+ */
+TEST_F(ThreadTest, ThreadPool) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.size(), 4u);
+
+  std::vector<int> results(64, 0);
+  for (size_t i = 0; i < results.size(); i++) {
+    pool.run([&results, i]() { results[i] = int(i) * 2; });
+  }
+  pool.wait();
+  for (size_t i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i], int(i) * 2);
+  }
+
+  // Errors surface in wait(), and don't stop the other tasks.
+  std::atomic<int> done(0);
+  pool.run([]() { throw std::runtime_error("task failed"); });
+  for (int i = 0; i < 8; i++) pool.run([&done]() { done++; });
+  bool caught = false;
+  try {
+    pool.wait();
+  } catch (const std::runtime_error &) {
+    caught = true;
+  }
+  EXPECT_TRUE(caught);
+  EXPECT_EQ(done.load(), 8);
+
+  // The pool is still usable afterwards.
+  pool.run([&done]() { done++; });
+  pool.wait();
+  EXPECT_EQ(done.load(), 9);
+}
+
+/**
+ * SpscQueue hands values from one thread to another in order, and pushes
+ * fail rather than block when it's full.
+ */
+TEST_F(ThreadTest, SpscQueue) {
+  SpscQueue<std::unique_ptr<int>> queue(2);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.push(std::make_unique<int>(1)));
+  EXPECT_TRUE(queue.push(std::make_unique<int>(2)));
+  auto rejected = std::make_unique<int>(3);
+  EXPECT_FALSE(queue.push(std::move(rejected)));
+  EXPECT_TRUE(bool(rejected)); // not moved from
+  EXPECT_EQ(*queue.pop().get(), 1);
+  EXPECT_EQ(*queue.pop().get(), 2);
+  EXPECT_FALSE(bool(queue.pop()));
+
+  // Across threads, through a queue much smaller than the stream.
+  SpscQueue<int> stream(16);
+  const int count = 100000;
+  std::thread producer([&]() {
+    for (int i = 0; i < count; i++) {
+      while (!stream.push(int(i))) std::this_thread::yield();
+    }
+  });
+  bool inOrder = true;
+  for (int expected = 0; expected < count;) {
+    if (const auto value = stream.pop()) {
+      inOrder = inOrder and value.get() == expected;
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(inOrder);
+  EXPECT_TRUE(stream.empty());
+}
+
+/**
+ * Latch::wait() returns once every task counted down, and not before.
+ */
+TEST_F(ThreadTest, Latch) {
+  ThreadPool pool(2);
+  Latch latch(3);
+  std::atomic<int> done(0);
+  for (int i = 0; i < 3; i++) {
+    pool.run([&]() {
+      done++;
+      latch.countDown();
+    });
+  }
+  latch.wait();
+  EXPECT_TRUE(latch.done());
+  EXPECT_EQ(done.load(), 3);
+  pool.wait();
+}
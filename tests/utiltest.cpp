@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include "util/types.hpp"
 #include "util/methods.hpp"
+#include "util/compression.hpp"
+#include "util/clocksync.hpp"
 
 /**
  * The basic utilities we have in src/util.
@@ -24,6 +26,97 @@ TEST_F(UtilTest, RollingSamplerTest) {
   EXPECT_EQ(sampler.mean<float>(), 6.0f);
   sampler.push(8);
   EXPECT_EQ(sampler.min(), 6);
+  EXPECT_EQ(sampler.mean<float>(), 7.0f);
+
+  // The extremes slide out of the window with their samples.
+  sampler.push(1);
+  sampler.push(2);
+  EXPECT_EQ(sampler.max(), 8);
+  sampler.push(3);
+  EXPECT_EQ(sampler.max(), 3);
+  EXPECT_EQ(sampler.min(), 1);
+  EXPECT_EQ(sampler.mean<float>(), 2.0f);
+}
+
+TEST_F(UtilTest, RollingSamplerPercentileTest) {
+  RollingSampler<int> sampler(100);
+  EXPECT_EQ(sampler.percentile(0.5), 0);
+  for (int i = 0; i < 200; i++) sampler.push(i % 100);
+  EXPECT_EQ(sampler.size(), 100u);
+  EXPECT_EQ(sampler.percentile(0.5), 50);
+  EXPECT_EQ(sampler.percentile(0.95), 95);
+  EXPECT_EQ(sampler.percentile(0.99), 99);
+  EXPECT_EQ(sampler.percentile(1), 99);
+  EXPECT_EQ(sampler.mean<float>(), 49.5f);
+}
+
+/**
+ * Samplers with a range answer percentiles from bucketed counts, to within a
+ * bucket, and the counts slide with the window.
+ */
+TEST_F(UtilTest, RollingSamplerBucketTest) {
+  RollingSampler<float> sampler(100, 0, 1, 50);
+  EXPECT_EQ(sampler.percentile(0.5), 0);
+  for (int i = 0; i < 200; i++) sampler.push((i % 100) / 100.0f);
+  EXPECT_NEAR(sampler.percentile(0.5), 0.5, 0.02);
+  EXPECT_NEAR(sampler.percentile(0.95), 0.95, 0.02);
+  EXPECT_LE(sampler.percentile(1), 0.99f);
+
+  // Old samples leave their buckets; outliers count in the end ones, and
+  // estimates stay within the window's extremes.
+  for (int i = 0; i < 90; i++) sampler.push(0.2);
+  for (int i = 0; i < 10; i++) sampler.push(3);
+  EXPECT_NEAR(sampler.percentile(0.5), 0.2, 0.02);
+  EXPECT_NEAR(sampler.percentile(0), 0.2, 0.02);
+  EXPECT_GT(sampler.percentile(0.95), 0.98);
+  EXPECT_LE(sampler.percentile(0.95), 3);
+}
+
+/**
+ * ClockSync trusts the least delayed samples, and tracks drift.
+ */
+TEST_F(UtilTest, ClockSyncTest) {
+  ClockSync sync(32, 8);
+  EXPECT_FALSE(sync.ready());
+
+  // The remote clock runs 0.1% fast, 5 seconds ahead. Every fourth pong is
+  // held up on its way back.
+  for (size_t i = 0; i < 32; i++) {
+    const Time sent = i;
+    const Time remote = (sent + 0.05) * 1.001 + 5;
+    sync.registerExchange(sent, remote, sent + ((i % 4 == 0) ? 0.6 : 0.1));
+  }
+  ASSERT_TRUE(sync.ready());
+
+  EXPECT_NEAR(sync.offset(40), 5.04, 1e-6);
+  EXPECT_NEAR(sync.skew(), 0.001, 1e-6);
+  EXPECT_NEAR(sync.error(), 0.05, 1e-6);
+  EXPECT_NEAR(sync.roundTrip(), 0.1, 1e-6);
+  EXPECT_GT(sync.jitter(), 0);
+
+  sync.reset();
+  EXPECT_FALSE(sync.ready());
+}
+
+/**
+ * FixedTimestep steps at a fixed rate through the real time it's given, and
+ * drops what it can't catch up on.
+ */
+TEST_F(UtilTest, FixedTimestepTest) {
+  FixedTimestep timestep(0.25, 3);
+  EXPECT_EQ(timestep.advance(0.125), 0);
+  EXPECT_EQ(timestep.untilNext(), 0.125);
+
+  EXPECT_EQ(timestep.advance(0.1875), 1);
+  EXPECT_EQ(timestep.lateness, 0.0625);
+  EXPECT_EQ(timestep.advance(0.5), 2);
+  EXPECT_EQ(timestep.dropped, 0);
+
+  // Eight steps behind: three run, five are dropped, the remainder stays.
+  EXPECT_EQ(timestep.advance(2), 3);
+  EXPECT_EQ(timestep.lateness, 1.8125);
+  EXPECT_EQ(timestep.dropped, 5);
+  EXPECT_EQ(timestep.untilNext(), 0.1875);
 }
 
 TEST_F(UtilTest, CooldownTest) {
@@ -60,6 +153,29 @@ TEST_F(UtilTest, AngleTest) {
   EXPECT_EQ(x = -10, 350);
 }
 
+/**
+ * Quantizers round-trip values within their precision's resolution.
+ */
+TEST_F(UtilTest, QuantizerTest) {
+  // Full precision is lossless.
+  const Quantizer full(Precision::Full, 0, 1);
+  EXPECT_EQ(full.decode(full.encode(1234.5678f)), 1234.5678f);
+
+  // Fixed precisions are accurate to a step.
+  const Quantizer fixed16(Precision::Fixed16, -100, 100);
+  EXPECT_NEAR(fixed16.decode(fixed16.encode(42.42f)), 42.42f, 200.0f / 65535);
+  EXPECT_LE(fixed16.encode(100), 65535u);
+  const Quantizer fixed8(Precision::Fixed8, 0, 360);
+  EXPECT_NEAR(fixed8.decode(fixed8.encode(271)), 271, 360.0f / 255);
+  EXPECT_LE(fixed8.encode(360), 255u);
+
+  // The bounds are exact, and values outside of them are clamped.
+  EXPECT_EQ(fixed16.decode(fixed16.encode(-100)), -100);
+  EXPECT_EQ(fixed16.decode(fixed16.encode(100)), 100);
+  EXPECT_EQ(fixed8.decode(fixed8.encode(-20)), 0);
+  EXPECT_EQ(fixed8.decode(fixed8.encode(1000)), 360);
+}
+
 TEST_F(UtilTest, AllocTest) {
   std::vector<PID> x = {3, 1, 0};
   EXPECT_EQ(smallestUnused(x), PID(2));
@@ -90,3 +206,24 @@ TEST_F(UtilTest, ReadTest) {
 
   // Other things??
 }
+
+/**
+ * The LZ codec round-trips data, and rejects malformed blocks.
+ */
+TEST_F(UtilTest, CompressionTest) {
+  std::vector<unsigned char> data;
+  for (size_t i = 0; i < 2000; i++) data.push_back((unsigned char) (i % 40));
+
+  std::vector<unsigned char> compressed, decompressed;
+  lzCompress(data.data(), data.size(), compressed);
+  EXPECT_LT(compressed.size(), data.size() / 4);
+  ASSERT_TRUE(lzDecompress(compressed.data(), compressed.size(),
+                           data.size(), decompressed));
+  EXPECT_EQ(decompressed, data);
+
+  // Wrong sizes and truncation are caught.
+  EXPECT_FALSE(lzDecompress(compressed.data(), compressed.size(),
+                            data.size() - 1, decompressed));
+  EXPECT_FALSE(lzDecompress(compressed.data(), compressed.size() / 2,
+                            data.size(), decompressed));
+}